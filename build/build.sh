@@ -4,12 +4,49 @@ CC=gcc
 EXE=vulkan_renderer
 SRC=../src/xcb_main.c
 INCLUDE=../src/
-LIBS="-lX11 -lX11-xcb -lm -lxcb -lxcb-xfixes -lxcb-keysyms -lvulkan"
+LIBS="-lX11 -lX11-xcb -lm -lxcb -lxcb-xfixes -lxcb-keysyms -lvulkan -lpthread"
 FLAGS="-g -Wall"
+# The cookers are built optimized, as the assets they load are what the build waits on.
+COOKER_FLAGS="$FLAGS -O2"
 
 sh compile_shaders.sh
 cp assets $BUILD_BIN_DIR/ -r
 
+# Mesh cooking
+printf "Cooking meshes...\n"
+
+$CC -o $BUILD_BIN_DIR/mesh_cooker ../src/mesh_cooker_main.c -I $INCLUDE $COOKER_FLAGS -lm
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+for obj in assets/*.obj; do
+	$BUILD_BIN_DIR/mesh_cooker $obj $BUILD_BIN_DIR/assets/$(basename $obj .obj).mesh
+	if [ $? -ne 0 ]; then
+		exit 1
+	fi
+done
+
+# The OBJ loading benchmark isn't run as part of the build. Run it with:
+# obj_benchmark assets/viking_room.obj
+$CC -o $BUILD_BIN_DIR/obj_benchmark ../src/obj_benchmark_main.c -I $INCLUDE $COOKER_FLAGS -lm
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+
+# Texture cooking
+printf "Cooking textures...\n"
+
+$CC -o $BUILD_BIN_DIR/texture_cooker ../src/texture_cooker_main.c -I $INCLUDE $COOKER_FLAGS -lm
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+for image in assets/*.bmp; do
+	$BUILD_BIN_DIR/texture_cooker $image $BUILD_BIN_DIR/assets/$(basename $image .bmp).texture
+	if [ $? -ne 0 ]; then
+		exit 1
+	fi
+done
+
 # Executable compilation
 printf "Compiling executable...\n"
 
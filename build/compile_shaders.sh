@@ -2,6 +2,13 @@ GLSLC=glslc
 SHADER_SRC=../src/shaders/
 SHADER_OUT=$BUILD_BIN_DIR/shaders
 
+# VOLATILE - The culling shader's buffers are sized by MESHES_COUNT in vulkan.c, which is the length
+# of the mesh asset manifest.
+MESHES_COUNT=$(sed -n 's/^#define MESH_ASSETS_LEN[[:space:]]*\([0-9]*\).*/\1/p' ../src/render_list.c)
+if [ -z "$MESHES_COUNT" ]; then
+	exit 1
+fi
+
 # Shader compilation
 $GLSLC $SHADER_SRC/world.vert -o $SHADER_OUT/world_vertex.spv
 if [ $? -ne 0 ]; then
@@ -11,3 +18,15 @@ $GLSLC $SHADER_SRC/world.frag -o $SHADER_OUT/world_fragment.spv
 if [ $? -ne 0 ]; then
 	exit 1
 fi
+$GLSLC $SHADER_SRC/world_depth.vert -o $SHADER_OUT/world_depth_vertex.spv
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+$GLSLC $SHADER_SRC/placeholder.frag -o $SHADER_OUT/placeholder_fragment.spv
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+$GLSLC -DMESHES_COUNT=$MESHES_COUNT $SHADER_SRC/world_cull.comp -o $SHADER_OUT/world_cull.spv
+if [ $? -ne 0 ]; then
+	exit 1
+fi
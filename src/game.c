@@ -3,6 +3,8 @@
 typedef struct
 {
 	double time_since_initialize;
+	bool   depth_prepass;
+	MsaaTier msaa_tier;
 	StaticMesh static_meshes[STATIC_MESHES_LEN];
 } GameMemory;
 
@@ -13,11 +15,14 @@ void game_initialize(void* mem, uint32_t mem_bytes)
     GameMemory* game = (GameMemory*)mem;
 
     game->time_since_initialize = 0;
+    game->depth_prepass         = false;
+    game->msaa_tier             = MSAA_TIER_DEFAULT;
 
 	for(uint8_t mesh_index = 0; mesh_index < STATIC_MESHES_LEN; mesh_index++)
 	{
 	    glm_mat4_identity(game->static_meshes[mesh_index].orientation);
-	    game->static_meshes[mesh_index].asset_handle = mesh_index;
+	    game->static_meshes[mesh_index].asset_handle    = mesh_index;
+	    game->static_meshes[mesh_index].material_handle = 0;
 	}
 	game->static_meshes[0].position = vec3_new(0, 0, 3);
 	game->static_meshes[1].position = vec3_new(2, 1, 1);
@@ -50,9 +55,23 @@ void game_loop(
 	    game->static_meshes[0].position = vec3_add(game->static_meshes[0].position, vec3_scale(vec3_new(input->mouse_delta_x, input->mouse_delta_y, 0), dt * 0.5));
     }
 
+    // Toggled at runtime so that both paths can be benchmarked against each other.
+    if(input->toggle_depth_prepass.pressed)
+    {
+	    game->depth_prepass = !game->depth_prepass;
+    }
+
+    // Cycles off, 2x, 4x, 8x and back to off.
+    if(input->cycle_msaa_tier.pressed)
+    {
+	    game->msaa_tier = (game->msaa_tier + 1) % MSAA_TIERS_LEN;
+    }
+
 	// NOW - define another transform on GameMemory -> define on RenderList -> define on UBO
 
 	render_list->clear_color     = vec3_new(0.01, 0.008, 0.02);
+	render_list->depth_prepass   = game->depth_prepass;
+	render_list->msaa_tier       = game->msaa_tier;
 
 	render_list->camera_position = vec3_new(0, 0, 0);
 	render_list->camera_target   = game->static_meshes[0].position;
@@ -0,0 +1,14 @@
+// FNV-1a over bytes. A hash can be continued across several calls by passing the previous result
+// back in; the first call starts from HASH_SEED.
+#define HASH_SEED 0xcbf29ce484222325ull
+
+uint64_t hash_bytes(uint64_t hash, void* bytes, uint64_t size)
+{
+	uint8_t* byte = bytes;
+	for(uint64_t byte_index = 0; byte_index < size; byte_index++)
+	{
+		hash ^= byte[byte_index];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
@@ -1,5 +1,5 @@
 // VOLATILE - this must match the number of buttons defined in input_state.
-#define INPUT_BUTTONS_LEN 4
+#define INPUT_BUTTONS_LEN 6
 
 typedef struct 
 {
@@ -24,6 +24,8 @@ typedef struct
         	InputButton move_back;
         	InputButton move_left;
         	InputButton move_right;
+        	InputButton toggle_depth_prepass;
+        	InputButton cycle_msaa_tier;
     	};
 	};
 } InputContext;
@@ -0,0 +1,113 @@
+// Cooked mesh file format, written offline by the mesh cooker (mesh_cooker_main.c) and mapped
+// straight into upload buffers by the renderer.
+//
+// The file is a MeshFileHeader followed by the vertex blob and the index blob, each starting at
+// the offset given in the header. All values are little endian.
+
+#define MESH_FILE_MAGIC   0x4853454d // "MESH"
+// Bump whenever MeshFileHeader or MeshVertex change, so that stale cooked files are rejected
+// rather than misread.
+#define MESH_FILE_VERSION 2
+
+// Blobs are aligned to this many bytes within the file.
+#define MESH_FILE_BLOB_ALIGNMENT 16
+
+#define MESH_ATTRIBUTE_POSITION   0
+#define MESH_ATTRIBUTE_TEXTURE_UV 1
+#define MESH_ATTRIBUTE_NORMAL     2
+#define MESH_ATTRIBUTES_COUNT     3
+
+typedef struct
+{
+	Vec3 position;
+	Vec2 texture_uv;
+	Vec3 normal;
+} MeshVertex;
+
+typedef struct
+{
+	// Number of 32 bit float components, or 0 if the attribute is absent.
+	uint32_t components_len;
+	uint32_t offset_in_vertex;
+} MeshFileAttribute;
+
+typedef struct
+{
+	uint32_t          magic;
+	uint32_t          version;
+
+	// Vertex layout descriptor, indexed by MESH_ATTRIBUTE_*.
+	uint32_t          vertex_stride;
+	MeshFileAttribute attributes[MESH_ATTRIBUTES_COUNT];
+	// 2 or 4 bytes.
+	uint32_t          index_size;
+
+	uint32_t          vertices_len;
+	uint32_t          indices_len;
+
+	// Bounding sphere in mesh space.
+	float             bounds_center[3];
+	float             bounds_radius;
+
+	uint64_t          vertices_offset;
+	uint64_t          indices_offset;
+
+	// Hash of the cooked vertex and index data (see mesh_content_hash), which lets the renderer
+	// recognize identical meshes cooked from different sources.
+	uint64_t          content_hash;
+} MeshFileHeader;
+
+uint64_t mesh_file_align(uint64_t offset)
+{
+	return (offset + MESH_FILE_BLOB_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_BLOB_ALIGNMENT - 1);
+}
+
+// Covers everything which affects what ends up on the GPU: the index width and both blobs. Bounds
+// are derived from the vertices, so they needn't be hashed.
+uint64_t mesh_content_hash(void* vertices, uint64_t vertices_size, void* indices, uint64_t indices_size, uint32_t index_size)
+{
+	uint64_t hash = HASH_SEED;
+	hash = hash_bytes(hash, &index_size, sizeof(index_size));
+	hash = hash_bytes(hash, vertices, vertices_size);
+	hash = hash_bytes(hash, indices, indices_size);
+	return hash;
+}
+
+// The layout MeshVertex has in memory, which is the only one the renderer currently accepts.
+MeshFileHeader mesh_file_header_for_mesh_vertex()
+{
+	MeshFileHeader header =
+	{
+		.magic         = MESH_FILE_MAGIC,
+		.version       = MESH_FILE_VERSION,
+		.vertex_stride = sizeof(MeshVertex)
+	};
+	header.attributes[MESH_ATTRIBUTE_POSITION]   = (MeshFileAttribute){ 3, offsetof(MeshVertex, position) };
+	header.attributes[MESH_ATTRIBUTE_TEXTURE_UV] = (MeshFileAttribute){ 2, offsetof(MeshVertex, texture_uv) };
+	header.attributes[MESH_ATTRIBUTE_NORMAL]     = (MeshFileAttribute){ 3, offsetof(MeshVertex, normal) };
+
+	return header;
+}
+
+// Checks a header read from a file of file_size bytes for a version and vertex layout we can use
+// as is, and for blobs that lie within the file.
+bool mesh_file_header_valid(MeshFileHeader* header, size_t file_size)
+{
+	MeshFileHeader expected = mesh_file_header_for_mesh_vertex();
+
+	if(file_size < sizeof(MeshFileHeader)
+		|| header->magic != expected.magic
+		|| header->version != expected.version
+		|| header->vertex_stride != expected.vertex_stride
+		|| memcmp(header->attributes, expected.attributes, sizeof(expected.attributes)) != 0
+		|| (header->index_size != 2 && header->index_size != 4))
+	{
+		return false;
+	}
+
+	uint64_t vertices_size = (uint64_t)header->vertices_len * header->vertex_stride;
+	uint64_t indices_size  = (uint64_t)header->indices_len  * header->index_size;
+
+	return header->vertices_offset + vertices_size <= file_size
+		&& header->indices_offset + indices_size <= file_size;
+}
@@ -0,0 +1,122 @@
+// Offline mesh cooker. Converts a Wavefront .obj file into the cooked mesh format described in
+// mesh.c, so that the renderer can upload it without parsing anything.
+//
+// Usage: mesh_cooker <input.obj> <output.mesh>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "panic.c"
+#include "linalg.c"
+#include "hash.c"
+#include "mesh.c"
+#include "obj.c"
+
+// Bounding sphere around the center of the mesh's bounding box.
+void mesh_cooker_compute_bounds(ObjMesh* mesh, Vec3* bounds_center, float* bounds_radius)
+{
+	Vec3 bounds_min = mesh->vertices[0].position;
+	Vec3 bounds_max = mesh->vertices[0].position;
+	for(uint32_t vertex_index = 1; vertex_index < mesh->vertices_len; vertex_index++)
+	{
+		Vec3 position = mesh->vertices[vertex_index].position;
+		for(uint8_t axis = 0; axis < 3; axis++)
+		{
+			bounds_min.data[axis] = fminf(bounds_min.data[axis], position.data[axis]);
+			bounds_max.data[axis] = fmaxf(bounds_max.data[axis], position.data[axis]);
+		}
+	}
+
+	*bounds_center = vec3_scale(vec3_add(bounds_min, bounds_max), 0.5f);
+	*bounds_radius = 0;
+	for(uint32_t vertex_index = 0; vertex_index < mesh->vertices_len; vertex_index++)
+	{
+		float distance = vec3_magnitude(vec3_sub(mesh->vertices[vertex_index].position, *bounds_center));
+		*bounds_radius = fmaxf(*bounds_radius, distance);
+	}
+}
+
+void mesh_cooker_write_padding(FILE* file, uint64_t* offset)
+{
+	static const uint8_t zeros[MESH_FILE_BLOB_ALIGNMENT] = {};
+
+	uint64_t aligned = mesh_file_align(*offset);
+	if(fwrite(zeros, 1, aligned - *offset, file) != aligned - *offset)
+	{
+		panic();
+	}
+	*offset = aligned;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	if(argc != 3)
+	{
+		printf("Usage: %s <input.obj> <output.mesh>\n", argv[0]);
+		return 1;
+	}
+
+	ObjData obj;
+	obj_load(&obj, argv[1]);
+
+	ObjMesh mesh;
+	obj_weld(&mesh, &obj);
+	obj_free(&obj);
+
+	Vec3  bounds_center;
+	float bounds_radius;
+	mesh_cooker_compute_bounds(&mesh, &bounds_center, &bounds_radius);
+
+	MeshFileHeader header = mesh_file_header_for_mesh_vertex();
+	header.index_size       = mesh.index_size;
+	header.vertices_len     = mesh.vertices_len;
+	header.indices_len      = mesh.indices_len;
+	header.bounds_center[0] = bounds_center.x;
+	header.bounds_center[1] = bounds_center.y;
+	header.bounds_center[2] = bounds_center.z;
+	header.bounds_radius    = bounds_radius;
+
+	uint64_t vertices_size = (uint64_t)mesh.vertices_len * sizeof(MeshVertex);
+	uint64_t indices_size  = (uint64_t)mesh.indices_len  * mesh.index_size;
+
+	header.vertices_offset = mesh_file_align(sizeof(MeshFileHeader));
+	header.indices_offset  = mesh_file_align(header.vertices_offset + vertices_size);
+	header.content_hash    = mesh_content_hash(mesh.vertices, vertices_size, mesh.indices, indices_size, mesh.index_size);
+
+	FILE* file = fopen(argv[2], "wb");
+	if(file == NULL)
+	{
+		printf("Failed to open file: %s\n", argv[2]);
+		return 1;
+	}
+
+	uint64_t offset = 0;
+	if(fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		panic();
+	}
+	offset += sizeof(header);
+
+	mesh_cooker_write_padding(file, &offset);
+	if(fwrite(mesh.vertices, 1, vertices_size, file) != vertices_size)
+	{
+		panic();
+	}
+	offset += vertices_size;
+
+	mesh_cooker_write_padding(file, &offset);
+	if(fwrite(mesh.indices, 1, indices_size, file) != indices_size)
+	{
+		panic();
+	}
+
+	fclose(file);
+	obj_free_mesh(&mesh);
+
+	printf("Cooked %s: %u vertices, %u indices (%u bit)\n", argv[2], header.vertices_len, header.indices_len, header.index_size * 8);
+	return 0;
+}
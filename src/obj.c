@@ -0,0 +1,529 @@
+// Wavefront .obj parsing, used by the mesh cooker. Only geometry is read: positions, texture UVs,
+// normals and faces.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One element of an "f" record, with all indices resolved to be 0 based. Missing texture UV and
+// normal indices are -1.
+typedef struct
+{
+	int32_t position_index;
+	int32_t texture_uv_index;
+	int32_t normal_index;
+} ObjCorner;
+
+// The attribute streams of an .obj file as they appear in the file, plus its faces triangulated
+// into corners, three per triangle.
+typedef struct
+{
+	Vec3*      positions;
+	uint32_t   positions_len;
+	uint32_t   positions_capacity;
+
+	Vec2*      texture_uvs;
+	uint32_t   texture_uvs_len;
+	uint32_t   texture_uvs_capacity;
+
+	Vec3*      normals;
+	uint32_t   normals_len;
+	uint32_t   normals_capacity;
+
+	ObjCorner* corners;
+	uint32_t   corners_len;
+	uint32_t   corners_capacity;
+} ObjData;
+
+// Makes room for one more element, doubling the array when it is full.
+void* obj_reserve(void* array, uint32_t len, uint32_t* capacity, size_t element_size)
+{
+	if(len < *capacity)
+	{
+		return array;
+	}
+
+	*capacity *= 2;
+	array = realloc(array, *capacity * element_size);
+	if(array == NULL)
+	{
+		panic();
+	}
+	return array;
+}
+
+// The parsing functions below never check for the end of the text. Instead every line they are
+// given, the last one included, is terminated by a '\n', which stops every scan. See obj_parse.
+
+void obj_skip_spaces(char** cursor)
+{
+	while(**cursor == ' ' || **cursor == '\t')
+	{
+		(*cursor)++;
+	}
+}
+
+bool obj_is_digit(char c)
+{
+	return (uint8_t)(c - '0') < 10;
+}
+
+// Parses a decimal float with optional sign, fraction and exponent. strtof can't be pointed at a
+// mapped file, which isn't null terminated, and is several times slower besides.
+//
+// The digits are accumulated as an integer and scaled once by a power of ten. This can be a
+// rounding step away from the correctly rounded value, which is well below what matters for
+// vertex data.
+static inline float obj_parse_float(char** cursor)
+{
+	static const double powers_of_ten[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	static const double inverse_powers_of_ten[] =
+	{
+		1e-0,  1e-1,  1e-2,  1e-3,  1e-4,  1e-5,  1e-6,  1e-7,  1e-8,  1e-9,  1e-10,
+		1e-11, 1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18, 1e-19, 1e-20, 1e-21, 1e-22
+	};
+
+	obj_skip_spaces(cursor);
+	char* start = *cursor;
+	char* c     = start;
+
+	// Signs are unpredictable, so they are skipped without branching.
+	bool negative = *c == '-';
+	c += negative | (*c == '+');
+
+	uint64_t mantissa = 0;
+	char*    integer_start = c;
+	for(; obj_is_digit(*c); c++)
+	{
+		mantissa = mantissa * 10 + (*c - '0');
+	}
+	int32_t digits_len = c - integer_start;
+	int32_t exponent   = 0;
+
+	if(*c == '.')
+	{
+		c++;
+		char* fraction_start = c;
+		for(; obj_is_digit(*c); c++)
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+		}
+		digits_len += c - fraction_start;
+		exponent   -= c - fraction_start;
+	}
+	if(digits_len == 0)
+	{
+		panic();
+	}
+
+	if(*c == 'e' || *c == 'E')
+	{
+		c++;
+		bool    exponent_negative = *c == '-';
+		int32_t exponent_value    = 0;
+		if(*c == '-' || *c == '+')
+		{
+			c++;
+		}
+		for(; obj_is_digit(*c); c++)
+		{
+			if(exponent_value < 1000)
+			{
+				exponent_value = exponent_value * 10 + (*c - '0');
+			}
+		}
+		exponent += exponent_negative ? -exponent_value : exponent_value;
+	}
+	*cursor = c;
+
+	// More digits than fit in the mantissa, or a scale the tables don't cover. Exporters don't
+	// write these, so copy the number out and let strtof deal with it.
+	if(digits_len > 18 || exponent > 22 || exponent < -22)
+	{
+		char number[64];
+		size_t number_len = c - start;
+		if(number_len >= sizeof(number))
+		{
+			panic();
+		}
+		memcpy(number, start, number_len);
+		number[number_len] = '\0';
+		return strtof(number, 0);
+	}
+
+	double value = (double)(int64_t)mantissa;
+	value *= exponent >= 0 ? powers_of_ten[exponent] : inverse_powers_of_ten[-exponent];
+
+	// Flipping the sign bit rather than negating keeps the sign from costing a branch, which would
+	// mispredict on about half of the coordinates in a typical file.
+	float    result = (float)value;
+	uint32_t bits;
+	memcpy(&bits, &result, sizeof(bits));
+	bits ^= (uint32_t)negative << 31;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// Parses an .obj index and resolves it to be 0 based. Negative indices count back from the most
+// recently defined element, so they are resolved against attributes_len.
+static inline int32_t obj_parse_index(char** cursor, uint32_t attributes_len)
+{
+	char* c = *cursor;
+
+	// Exporters rarely write negative indices, so unlike float signs they are branched on.
+	bool negative = *c == '-';
+	if(negative)
+	{
+		c++;
+	}
+
+	char*    digits = c;
+	uint32_t value  = 0;
+	for(; obj_is_digit(*c); c++)
+	{
+		value = value * 10 + (*c - '0');
+	}
+	*cursor = c;
+
+	// An index of 0, which isn't valid either way, or with no digits at all resolves out of range.
+	uint32_t index = negative ? attributes_len - value : value - 1;
+	if(index >= attributes_len || c - digits > 9)
+	{
+		panic();
+	}
+	return (int32_t)index;
+}
+
+// Parses one "v", "v/vt", "v//vn" or "v/vt/vn" face element.
+static inline ObjCorner obj_parse_corner(char** cursor, ObjData* obj)
+{
+	ObjCorner corner =
+	{
+		.position_index   = obj_parse_index(cursor, obj->positions_len),
+		.texture_uv_index = -1,
+		.normal_index     = -1
+	};
+
+	if(**cursor == '/')
+	{
+		(*cursor)++;
+		if(**cursor != '/')
+		{
+			corner.texture_uv_index = obj_parse_index(cursor, obj->texture_uvs_len);
+		}
+		if(**cursor == '/')
+		{
+			(*cursor)++;
+			corner.normal_index = obj_parse_index(cursor, obj->normals_len);
+		}
+	}
+
+	return corner;
+}
+
+// Parses whole lines, from text up to end, which must directly follow a '\n'.
+void obj_parse_lines(ObjData* obj, char* text, char* end)
+{
+	char* cursor = text;
+	while(cursor < end)
+	{
+		obj_skip_spaces(&cursor);
+
+		// Keywords are told apart by their first two characters and the whitespace after them.
+		// The line's '\n' is always there to stop the comparisons in time.
+		bool keyword_v  = cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t');
+		bool keyword_vt = cursor[0] == 'v' && cursor[1] == 't' && (cursor[2] == ' ' || cursor[2] == '\t');
+		bool keyword_vn = cursor[0] == 'v' && cursor[1] == 'n' && (cursor[2] == ' ' || cursor[2] == '\t');
+		bool keyword_f  = cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t');
+
+		if(keyword_v)
+		{
+			cursor += 1;
+			obj->positions = obj_reserve(obj->positions, obj->positions_len, &obj->positions_capacity, sizeof(Vec3));
+
+			Vec3* position = &obj->positions[obj->positions_len++];
+			position->x = obj_parse_float(&cursor);
+			position->y = obj_parse_float(&cursor);
+			position->z = obj_parse_float(&cursor);
+		}
+		else if(keyword_vt)
+		{
+			cursor += 2;
+			obj->texture_uvs = obj_reserve(obj->texture_uvs, obj->texture_uvs_len, &obj->texture_uvs_capacity, sizeof(Vec2));
+
+			// Texture V is flipped, as .obj has its origin at the bottom left and Vulkan at the top left.
+			Vec2* texture_uv = &obj->texture_uvs[obj->texture_uvs_len++];
+			texture_uv->x = obj_parse_float(&cursor);
+			texture_uv->y = 1 - obj_parse_float(&cursor);
+		}
+		else if(keyword_vn)
+		{
+			cursor += 2;
+			obj->normals = obj_reserve(obj->normals, obj->normals_len, &obj->normals_capacity, sizeof(Vec3));
+
+			Vec3* normal = &obj->normals[obj->normals_len++];
+			normal->x = obj_parse_float(&cursor);
+			normal->y = obj_parse_float(&cursor);
+			normal->z = obj_parse_float(&cursor);
+		}
+		else if(keyword_f)
+		{
+			cursor += 1;
+
+			// Polygons are triangulated as a fan around their first element, which is correct for
+			// the convex polygons exporters write.
+			ObjCorner first;
+			ObjCorner previous;
+			uint32_t  corners_len = 0;
+			while(true)
+			{
+				obj_skip_spaces(&cursor);
+				if(*cursor == '\n' || *cursor == '\r' || *cursor == '#')
+				{
+					break;
+				}
+
+				ObjCorner corner = obj_parse_corner(&cursor, obj);
+				if(corners_len == 0)
+				{
+					first = corner;
+				}
+				else if(corners_len >= 2)
+				{
+					// Room for all three corners.
+					obj->corners = obj_reserve(obj->corners, obj->corners_len + 2, &obj->corners_capacity, sizeof(ObjCorner));
+					obj->corners[obj->corners_len++] = first;
+					obj->corners[obj->corners_len++] = previous;
+					obj->corners[obj->corners_len++] = corner;
+				}
+				previous = corner;
+				corners_len++;
+			}
+			if(corners_len < 3)
+			{
+				panic();
+			}
+		}
+
+		// Skip whatever remains of the line, which covers comments and unsupported records.
+		while(*cursor != '\n')
+		{
+			cursor++;
+		}
+		cursor++;
+	}
+}
+
+// Scans a mapped .obj file in a single pass. Only geometry is read; groups, materials, smoothing
+// groups and the like are skipped.
+void obj_parse(ObjData* obj, char* text, size_t text_len)
+{
+	*obj = (ObjData){};
+
+	// Start off with room for the most elements a file of this size is likely to hold, so that
+	// growing the arrays is rare. Lines are rarely shorter than 32 bytes, and each face line holds
+	// at least one triangle.
+	obj->positions_capacity   = text_len / 32 + 1;
+	obj->texture_uvs_capacity = text_len / 32 + 1;
+	obj->normals_capacity     = text_len / 32 + 1;
+	obj->corners_capacity     = text_len / 32 * 3 + 3;
+
+	obj->positions   = malloc(obj->positions_capacity   * sizeof(Vec3));
+	obj->texture_uvs = malloc(obj->texture_uvs_capacity * sizeof(Vec2));
+	obj->normals     = malloc(obj->normals_capacity     * sizeof(Vec3));
+	obj->corners     = malloc(obj->corners_capacity     * sizeof(ObjCorner));
+	if(obj->positions == NULL || obj->texture_uvs == NULL || obj->normals == NULL || obj->corners == NULL)
+	{
+		panic();
+	}
+
+	// Every line up to the file's last '\n' is parsed in place. Whatever follows it, a last line
+	// without a '\n' of its own, is copied out and given one.
+	char* lines_end = text + text_len;
+	while(lines_end > text && lines_end[-1] != '\n')
+	{
+		lines_end--;
+	}
+	obj_parse_lines(obj, text, lines_end);
+
+	size_t last_line_len = text + text_len - lines_end;
+	if(last_line_len > 0)
+	{
+		char* last_line = malloc(last_line_len + 1);
+		if(last_line == NULL)
+		{
+			panic();
+		}
+		memcpy(last_line, lines_end, last_line_len);
+		last_line[last_line_len] = '\n';
+
+		obj_parse_lines(obj, last_line, last_line + last_line_len + 1);
+		free(last_line);
+	}
+}
+
+void obj_free(ObjData* obj)
+{
+	free(obj->positions);
+	free(obj->texture_uvs);
+	free(obj->normals);
+	free(obj->corners);
+	*obj = (ObjData){};
+}
+
+// Welded vertices and indices, ready to be cooked.
+typedef struct
+{
+	MeshVertex* vertices;
+	uint32_t    vertices_len;
+
+	// uint16_t or uint32_t, as given by index_size.
+	void*       indices;
+	uint32_t    indices_len;
+	uint32_t    index_size;
+} ObjMesh;
+
+typedef struct
+{
+	ObjCorner key;
+	// UINT32_MAX if the entry is empty.
+	uint32_t  vertex_index;
+} ObjWeldEntry;
+
+uint32_t obj_hash_corner(ObjCorner corner)
+{
+	uint32_t hash = 2166136261u;
+	hash = (hash ^ (uint32_t)corner.position_index)   * 16777619u;
+	hash = (hash ^ (uint32_t)corner.texture_uv_index) * 16777619u;
+	hash = (hash ^ (uint32_t)corner.normal_index)     * 16777619u;
+	return hash ^ (hash >> 15);
+}
+
+// The tricky thing about .obj is attributes being indexed separately per face element, as opposed
+// to there being one index per vertex buffer vertex, you see.
+//
+// To fix this, every distinct (position, texture UV, normal) triple becomes one vertex, found
+// through an open addressing hash map keyed on the triple's indices. Corners that share all three
+// share a vertex, and corners that share a position but not a UV (texture seams) get their own.
+void obj_weld(ObjMesh* mesh, ObjData* obj)
+{
+	// At most half full, so probe sequences stay short.
+	uint32_t entries_len = 1;
+	while(entries_len < obj->corners_len * 2)
+	{
+		entries_len *= 2;
+	}
+	ObjWeldEntry* entries = malloc(entries_len * sizeof(ObjWeldEntry));
+
+	// The unique vertex count isn't known up front, but can't exceed the corner count.
+	mesh->vertices_len = 0;
+	mesh->vertices     = malloc(obj->corners_len * sizeof(MeshVertex));
+	mesh->indices_len  = obj->corners_len;
+	mesh->indices      = malloc(obj->corners_len * sizeof(uint32_t));
+	if(entries == NULL || mesh->vertices == NULL || mesh->indices == NULL)
+	{
+		panic();
+	}
+	memset(entries, 0xff, entries_len * sizeof(ObjWeldEntry));
+
+	uint32_t* indices = mesh->indices;
+	for(uint32_t corner_index = 0; corner_index < obj->corners_len; corner_index++)
+	{
+		ObjCorner corner = obj->corners[corner_index];
+
+		uint32_t entry_index = obj_hash_corner(corner) & (entries_len - 1);
+		while(true)
+		{
+			ObjWeldEntry* entry = &entries[entry_index];
+			if(entry->vertex_index == UINT32_MAX)
+			{
+				MeshVertex* vertex = &mesh->vertices[mesh->vertices_len];
+				vertex->position   = obj->positions[corner.position_index];
+				vertex->texture_uv = corner.texture_uv_index != -1 ? obj->texture_uvs[corner.texture_uv_index] : (Vec2){};
+				// CONSIDER - Generate normals for meshes that don't have them, once they are used.
+				vertex->normal     = corner.normal_index != -1 ? obj->normals[corner.normal_index] : (Vec3){};
+
+				entry->key          = corner;
+				entry->vertex_index = mesh->vertices_len++;
+				break;
+			}
+			if(entry->key.position_index == corner.position_index
+				&& entry->key.texture_uv_index == corner.texture_uv_index
+				&& entry->key.normal_index == corner.normal_index)
+			{
+				break;
+			}
+			entry_index = (entry_index + 1) & (entries_len - 1);
+		}
+		indices[corner_index] = entries[entry_index].vertex_index;
+	}
+	free(entries);
+
+	mesh->vertices = realloc(mesh->vertices, mesh->vertices_len * sizeof(MeshVertex));
+
+	// Narrow the indices to 16 bits when every vertex can be addressed with them.
+	if(mesh->vertices_len <= UINT16_MAX)
+	{
+		uint16_t* narrow_indices = malloc(mesh->indices_len * sizeof(uint16_t));
+		if(narrow_indices == NULL)
+		{
+			panic();
+		}
+
+		for(uint32_t index = 0; index < mesh->indices_len; index++)
+		{
+			narrow_indices[index] = (uint16_t)indices[index];
+		}
+		free(indices);
+
+		mesh->index_size = sizeof(uint16_t);
+		mesh->indices    = narrow_indices;
+	}
+	else
+	{
+		mesh->index_size = sizeof(uint32_t);
+	}
+}
+
+// Maps and parses an .obj file.
+void obj_load(ObjData* obj, char* filename)
+{
+	int32_t file = open(filename, O_RDONLY);
+	if(file == -1)
+	{
+		panic();
+	}
+
+	struct stat file_stat;
+	if(fstat(file, &file_stat) == -1 || file_stat.st_size == 0)
+	{
+		panic();
+	}
+
+	char* text = mmap(0, file_stat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+	if(text == MAP_FAILED)
+	{
+		panic();
+	}
+	close(file);
+
+	obj_parse(obj, text, file_stat.st_size);
+	munmap(text, file_stat.st_size);
+
+	if(obj->positions_len == 0 || obj->corners_len == 0)
+	{
+		panic();
+	}
+}
+
+void obj_free_mesh(ObjMesh* mesh)
+{
+	free(mesh->vertices);
+	free(mesh->indices);
+	*mesh = (ObjMesh){};
+}
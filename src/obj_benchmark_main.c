@@ -0,0 +1,197 @@
+// OBJ loading benchmark. Times obj_load against the fscanf based loader it replaced, which is kept
+// here as the reference, and reports the best run of each.
+//
+// Usage: obj_benchmark <input.obj> [runs]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "panic.c"
+#include "linalg.c"
+#include "hash.c"
+#include "mesh.c"
+#include "obj.c"
+
+#define OBJ_BENCHMARK_DEFAULT_RUNS    200
+#define OBJ_BENCHMARK_TARGET_SPEEDUP  10
+
+#define OBJ_BENCHMARK_FSCANF_VERTICES_MAX     64000
+#define OBJ_BENCHMARK_FSCANF_INDICES_MAX      64000
+#define OBJ_BENCHMARK_FSCANF_TEXTURE_UVS_MAX  8000
+#define OBJ_BENCHMARK_FSCANF_ELEMENTS_MAX     32000
+
+// What the fscanf loader produced: one vertex per position, with UVs applied retroactively.
+typedef struct
+{
+	MeshVertex vertices[OBJ_BENCHMARK_FSCANF_VERTICES_MAX];
+	uint32_t   vertices_len;
+
+	uint32_t   indices[OBJ_BENCHMARK_FSCANF_INDICES_MAX];
+	uint32_t   indices_len;
+} ObjBenchmarkFscanfData;
+
+// The loader as it was before obj_load, unchanged but for its names, and its arrays being static
+// rather than on the stack.
+void obj_benchmark_fscanf_load(ObjBenchmarkFscanfData* data, char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if(file == NULL)
+	{
+		panic();
+	}
+
+	static Vec2 tmp_texture_uvs[OBJ_BENCHMARK_FSCANF_TEXTURE_UVS_MAX];
+	uint32_t    tmp_texture_uvs_len = 0;
+
+	static struct
+	{
+		uint32_t vertex_index;
+		uint32_t texture_uv_index;
+	} tmp_face_elements[OBJ_BENCHMARK_FSCANF_ELEMENTS_MAX];
+	uint32_t tmp_face_elements_len = 0;
+
+	data->vertices_len = 0;
+	while(true)
+	{
+		char keyword[128];
+		int32_t res = fscanf(file, "%s", keyword);
+
+		if(res == EOF)
+		{
+			break;
+		}
+
+		if(strcmp(keyword, "v") == 0)
+		{
+			Vec3* pos = &data->vertices[data->vertices_len].position;
+			fscanf(file, "%f %f %f", &pos->x, &pos->y, &pos->z);
+			data->vertices_len++;
+		}
+		else if(strcmp(keyword, "vt") == 0)
+		{
+			Vec2* tmp_texture_uv = &tmp_texture_uvs[tmp_texture_uvs_len];
+			fscanf(file, "%f %f", &tmp_texture_uv->x, &tmp_texture_uv->y);
+			tmp_texture_uv->y = 1 - tmp_texture_uv->y;
+			tmp_texture_uvs_len++;
+		}
+		else if(strcmp(keyword, "f") == 0)
+		{
+			int32_t throwaways[3];
+			int32_t values_len = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
+				&tmp_face_elements[tmp_face_elements_len + 0].vertex_index,
+				&tmp_face_elements[tmp_face_elements_len + 0].texture_uv_index,
+				&throwaways[0],
+				&tmp_face_elements[tmp_face_elements_len + 1].vertex_index,
+				&tmp_face_elements[tmp_face_elements_len + 1].texture_uv_index,
+				&throwaways[1],
+				&tmp_face_elements[tmp_face_elements_len + 2].vertex_index,
+				&tmp_face_elements[tmp_face_elements_len + 2].texture_uv_index,
+				&throwaways[2]);
+
+			if(values_len != 9)
+			{
+				panic();
+			}
+			tmp_face_elements_len += 3;
+		}
+	}
+	fclose(file);
+
+	data->indices_len  = 0;
+	for(uint32_t element_index = 0; element_index < tmp_face_elements_len; element_index++)
+	{
+		uint32_t index = tmp_face_elements[element_index].vertex_index - 1;
+		data->indices[element_index] = index;
+		data->vertices[index].texture_uv = tmp_texture_uvs[tmp_face_elements[element_index].texture_uv_index - 1];
+
+		data->indices_len++;
+	}
+}
+
+double obj_benchmark_seconds()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	if(argc != 2 && argc != 3)
+	{
+		printf("Usage: %s <input.obj> [runs]\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t runs = argc == 3 ? (uint32_t)atoi(argv[2]) : OBJ_BENCHMARK_DEFAULT_RUNS;
+	if(runs == 0)
+	{
+		printf("Runs must be at least 1.\n");
+		return 1;
+	}
+
+	// The fscanf loader's arrays stay mapped from one run to the next, as its stack arrays did in the
+	// cooker. Memory obj_load frees is kept mapped too, rather than given back and page faulted in
+	// again on every run.
+	mallopt(M_MMAP_THRESHOLD, 256 * 1024 * 1024);
+	mallopt(M_TRIM_THRESHOLD, 256 * 1024 * 1024);
+
+	static ObjBenchmarkFscanfData fscanf_data;
+	double fscanf_best = INFINITY;
+	double load_best   = INFINITY;
+	double weld_best   = INFINITY;
+
+	// The runs of each loader are interleaved, so that both see the same conditions.
+	for(uint32_t run = 0; run < runs; run++)
+	{
+		double start = obj_benchmark_seconds();
+		obj_benchmark_fscanf_load(&fscanf_data, argv[1]);
+		fscanf_best = fmin(fscanf_best, obj_benchmark_seconds() - start);
+
+		ObjData obj;
+		start = obj_benchmark_seconds();
+		obj_load(&obj, argv[1]);
+		load_best = fmin(load_best, obj_benchmark_seconds() - start);
+
+		ObjMesh mesh;
+		start = obj_benchmark_seconds();
+		obj_weld(&mesh, &obj);
+		weld_best = fmin(weld_best, obj_benchmark_seconds() - start);
+
+		// The parsers must agree on what they read. The welded mesh can't be compared against the
+		// fscanf loader's, which doesn't split vertices on UV seams.
+		if(obj.positions_len != fscanf_data.vertices_len || obj.corners_len != fscanf_data.indices_len)
+		{
+			panic();
+		}
+		for(uint32_t corner_index = 0; corner_index < obj.corners_len; corner_index++)
+		{
+			if((uint32_t)obj.corners[corner_index].position_index != fscanf_data.indices[corner_index])
+			{
+				panic();
+			}
+		}
+
+		obj_free_mesh(&mesh);
+		obj_free(&obj);
+	}
+
+	double speedup = fscanf_best / load_best;
+	printf("%s, best of %u runs:\n", argv[1], runs);
+	printf("  fscanf loader: %8.3f ms\n", fscanf_best * 1000);
+	printf("  obj_load:      %8.3f ms (%.1fx)\n", load_best * 1000, speedup);
+	printf("  obj_weld:      %8.3f ms\n", weld_best * 1000);
+
+	if(speedup < OBJ_BENCHMARK_TARGET_SPEEDUP)
+	{
+		printf("obj_load is below the %ux target.\n", OBJ_BENCHMARK_TARGET_SPEEDUP);
+		return 1;
+	}
+	return 0;
+}
@@ -1,6 +1,37 @@
+// Mesh asset manifest. An asset handle is an index into this list, so handles stay stable for as
+// long as the list is only appended to. Several handles may name the same file, or files with
+// identical contents, in which case the renderer loads and uploads the mesh only once.
+#define MESH_ASSETS_LEN 2
+char* mesh_asset_paths[MESH_ASSETS_LEN] =
+{
+	"assets/viking_room.mesh",
+	"assets/viking_room.mesh"
+};
+
+// Material asset manifest, with the same rules as the mesh asset manifest. For now a material is
+// only its texture.
+#define MATERIAL_ASSETS_LEN 1
+char* material_asset_texture_paths[MATERIAL_ASSETS_LEN] =
+{
+	"assets/viking_room.texture"
+};
+
+// Multisampling quality tiers. Backends fall back to the highest sample count the device supports
+// at or below the tier's.
+typedef enum
+{
+	MSAA_TIER_OFF,
+	MSAA_TIER_2X,
+	MSAA_TIER_4X,
+	MSAA_TIER_8X,
+	MSAA_TIERS_LEN
+} MsaaTier;
+#define MSAA_TIER_DEFAULT MSAA_TIER_4X
+
 typedef struct
 {
-	uint32_t asset_handle;
+	uint32_t asset_handle;    // index into mesh_asset_paths
+	uint32_t material_handle; // index into material_asset_texture_paths
 	Vec3     position;
 	mat4     orientation;
 } StaticMesh;
@@ -8,6 +39,12 @@ typedef struct
 typedef struct
 {
 	Vec3       clear_color;
+	// Draw the world depth only first, then shade it with an EQUAL depth test, so that each pixel
+	// is shaded once. Pays off with heavy fragment shading and a lot of overdraw.
+	bool       depth_prepass;
+	// Changing tiers rebuilds everything that depends on the sample count, so it shouldn't happen
+	// every frame.
+	MsaaTier   msaa_tier;
 
 	Vec3       camera_position;
 	Vec3       camera_target;
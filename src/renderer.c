@@ -41,7 +41,8 @@ void renderer_initialize(Renderer* renderer, RendererPlatformData* platform_spec
 	}
 }
 
-void renderer_loop(Renderer* renderer, RenderList* render_list)
+// Returns false if there is currently nothing to render to. See vulkan_loop.
+bool renderer_loop(Renderer* renderer, RenderList* render_list)
 {
-	vulkan_loop(&renderer->vulkan, render_list);
+	return vulkan_loop(&renderer->vulkan, render_list);
 }
@@ -0,0 +1,12 @@
+#version 450
+
+// Stands in for world.frag while it compiles. Shares its pipeline layout, so it must not declare
+// bindings world.frag doesn't have.
+
+layout(location = 0) in vec2 frag_texture_coord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
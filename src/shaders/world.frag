@@ -1,11 +1,21 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec2 frag_texture_coord;
+layout(location = 1) flat in uint frag_material_index;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 2) uniform sampler2D texture_sampler;
+// Indexed by texture. Only slots of bound textures are written, which materials only point at once
+// they are (see VulkanHostMappedMaterial).
+layout(binding = 2) uniform sampler2D textures[];
+
+layout(std430, binding = 5) readonly buffer ssbo_material {
+	uint texture_indices[];
+} material;
 
 void main() {
-	outColor = texture(texture_sampler, frag_texture_coord);
+	// Instances in one draw can have different materials, so the index is not dynamically uniform.
+	uint texture_index = material.texture_indices[frag_material_index];
+	outColor = texture(textures[nonuniformEXT(texture_index)], frag_texture_coord);
 }
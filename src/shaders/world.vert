@@ -2,20 +2,44 @@
 
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec2 in_texture_coord;
+layout(location = 2) in vec3 in_normal;
 
 layout(location = 0) out vec2 frag_texture_coord;
+layout(location = 1) flat out uint frag_material_index;
 
 layout(binding = 0) uniform ubo_global {
 	mat4 view;
 	mat4 projection;
+	mat4 view_projection;
 	vec3 clear_color;
+	uint instances_len;
 } global;
 
-layout(binding = 1) uniform ubo_inst {
-	mat4 model;
+layout(std430, binding = 1) readonly buffer ssbo_inst {
+	mat4 models[];
 } inst;
 
+// VOLATILE - Must match VulkanDrawPushConstants in vulkan_context.c.
+layout(push_constant) uniform push_draw {
+	uint first_visible_instance;
+} draw;
+
+// Written by world_cull.comp. Maps each drawn instance to its index in inst.models.
+layout(std430, binding = 3) readonly buffer ssbo_cull {
+	uint visible_instances[];
+} cull;
+
+layout(std430, binding = 4) readonly buffer ssbo_inst_material {
+	uint material_indices[];
+} inst_material;
+
+// VOLATILE - Must be computed exactly as in world_depth.vert, for the EQUAL depth test after the
+// depth pre-pass.
+invariant gl_Position;
+
 void main() {
-	gl_Position = global.projection * global.view * inst.model * vec4(in_pos, 1.0);
+	uint instance = cull.visible_instances[draw.first_visible_instance + gl_InstanceIndex];
+	gl_Position = global.view_projection * inst.models[instance] * vec4(in_pos, 1.0);
     frag_texture_coord = in_texture_coord;
+	frag_material_index = inst_material.material_indices[instance];
 }
@@ -0,0 +1,35 @@
+#version 450
+
+// Depth pre-pass. Positions come from the meshes' position streams, and there is no fragment
+// shader.
+
+layout(location = 0) in vec3 in_pos;
+
+layout(binding = 0) uniform ubo_global {
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	vec3 clear_color;
+	uint instances_len;
+} global;
+
+layout(std430, binding = 1) readonly buffer ssbo_inst {
+	mat4 models[];
+} inst;
+
+// VOLATILE - Must match VulkanDrawPushConstants in vulkan_context.c.
+layout(push_constant) uniform push_draw {
+	uint first_visible_instance;
+} draw;
+
+layout(std430, binding = 2) readonly buffer ssbo_cull {
+	uint visible_instances[];
+} cull;
+
+// VOLATILE - Must be computed exactly as in world.vert.
+invariant gl_Position;
+
+void main() {
+	uint instance = cull.visible_instances[draw.first_visible_instance + gl_InstanceIndex];
+	gl_Position = global.view_projection * inst.models[instance] * vec4(in_pos, 1.0);
+}
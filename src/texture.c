@@ -0,0 +1,493 @@
+// Cooked texture file format, written offline by the texture cooker (texture_cooker_main.c) and
+// uploaded by the renderer block for block, without decoding anything.
+//
+// The file is a TextureFileHeader followed by the blocks of every mip level, largest first, each
+// starting at the offset given in the header. All values are little endian. The chain of levels is
+// always full, down to 1x1, as block compressed levels can't be blitted down on the GPU.
+//
+// The decoders at the bottom are a fallback for devices which can't sample BC formats.
+
+#define TEXTURE_FILE_MAGIC   0x52584554 // "TEXR"
+// Bump whenever TextureFileHeader or the block encodings change, so that stale cooked files are
+// rejected rather than misread.
+#define TEXTURE_FILE_VERSION 1
+
+// Levels are aligned to this many bytes within the file, which is also the largest block size.
+#define TEXTURE_FILE_LEVEL_ALIGNMENT 16
+
+// Enough for a full chain down from 65536x65536.
+#define TEXTURE_FILE_LEVELS_MAX 17
+
+// Every format holds sRGB color with linear alpha.
+typedef enum
+{
+	// 4 bits per texel, color with 1 bit alpha. The cooker only emits it for opaque images.
+	TEXTURE_FORMAT_BC1 = 1,
+	// 8 bits per texel, BC1 color plus interpolated alpha.
+	TEXTURE_FORMAT_BC3 = 2,
+	// 8 bits per texel, the best quality of the three.
+	TEXTURE_FORMAT_BC7 = 3
+} TextureFormat;
+
+typedef struct
+{
+	uint64_t offset;
+	uint64_t size;
+} TextureFileLevel;
+
+typedef struct
+{
+	uint32_t         magic;
+	uint32_t         version;
+
+	// TextureFormat.
+	uint32_t         format;
+	uint32_t         width;
+	uint32_t         height;
+	uint32_t         mip_levels;
+
+	TextureFileLevel levels[TEXTURE_FILE_LEVELS_MAX];
+} TextureFileHeader;
+
+uint64_t texture_file_align(uint64_t offset)
+{
+	return (offset + TEXTURE_FILE_LEVEL_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_FILE_LEVEL_ALIGNMENT - 1);
+}
+
+// Bytes per 4x4 block.
+uint32_t texture_format_block_size(TextureFormat format)
+{
+	return format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+}
+
+uint32_t texture_level_dimension(uint32_t dimension, uint32_t level)
+{
+	dimension >>= level;
+	return dimension > 0 ? dimension : 1;
+}
+
+// The number of levels in a full chain, down to 1x1.
+uint32_t texture_full_mip_levels(uint32_t width, uint32_t height)
+{
+	uint32_t mip_levels = 1;
+	while(texture_level_dimension(width, mip_levels - 1) > 1 || texture_level_dimension(height, mip_levels - 1) > 1)
+	{
+		mip_levels++;
+	}
+	return mip_levels;
+}
+
+// Partial blocks at the right and bottom edges are stored whole.
+uint64_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height)
+{
+	return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * texture_format_block_size(format);
+}
+
+// Checks a header read from a file of file_size bytes for a version and format we can read, and
+// for a full chain of levels which are the expected size and lie within the file.
+bool texture_file_header_valid(TextureFileHeader* header, size_t file_size)
+{
+	if(file_size < sizeof(TextureFileHeader)
+		|| header->magic != TEXTURE_FILE_MAGIC
+		|| header->version != TEXTURE_FILE_VERSION
+		|| header->format < TEXTURE_FORMAT_BC1
+		|| header->format > TEXTURE_FORMAT_BC7
+		|| header->width == 0
+		|| header->height == 0
+		|| header->mip_levels > TEXTURE_FILE_LEVELS_MAX
+		|| header->mip_levels != texture_full_mip_levels(header->width, header->height))
+	{
+		return false;
+	}
+
+	for(uint32_t level = 0; level < header->mip_levels; level++)
+	{
+		TextureFileLevel* file_level = &header->levels[level];
+		uint64_t expected_size = texture_level_size(
+			header->format,
+			texture_level_dimension(header->width, level),
+			texture_level_dimension(header->height, level));
+
+		if(file_level->size != expected_size
+			|| file_level->offset % TEXTURE_FILE_LEVEL_ALIGNMENT != 0
+			|| file_level->offset + file_level->size > file_size)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void texture_rgb565_to_rgba(uint16_t color, uint8_t* rgba)
+{
+	uint8_t red   = (color >> 11) & 0x1f;
+	uint8_t green = (color >> 5)  & 0x3f;
+	uint8_t blue  =  color        & 0x1f;
+
+	rgba[0] = (red   << 3) | (red   >> 2);
+	rgba[1] = (green << 2) | (green >> 4);
+	rgba[2] = (blue  << 3) | (blue  >> 2);
+	rgba[3] = 255;
+}
+
+// The color half of BC1 and BC3 blocks. BC3 always interpolates four colors, whereas BC1 switches
+// to three colors and transparent black when the first endpoint isn't the larger one.
+void texture_decode_bc1_colors(uint8_t* block, bool four_colors, uint8_t texels[16][4])
+{
+	uint16_t color_0 = block[0] | (block[1] << 8);
+	uint16_t color_1 = block[2] | (block[3] << 8);
+
+	uint8_t palette[4][4];
+	texture_rgb565_to_rgba(color_0, palette[0]);
+	texture_rgb565_to_rgba(color_1, palette[1]);
+
+	for(uint8_t channel = 0; channel < 3; channel++)
+	{
+		if(four_colors || color_0 > color_1)
+		{
+			palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+			palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+		}
+		else
+		{
+			palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2;
+			palette[3][channel] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = (four_colors || color_0 > color_1) ? 255 : 0;
+
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		memcpy(texels[texel], palette[(indices >> (texel * 2)) & 3], 4);
+	}
+}
+
+void texture_decode_bc3_alpha(uint8_t* block, uint8_t texels[16][4])
+{
+	uint8_t palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+	if(palette[0] > palette[1])
+	{
+		for(uint8_t step = 1; step < 7; step++)
+		{
+			palette[step + 1] = ((7 - step) * palette[0] + step * palette[1]) / 7;
+		}
+	}
+	else
+	{
+		for(uint8_t step = 1; step < 5; step++)
+		{
+			palette[step + 1] = ((5 - step) * palette[0] + step * palette[1]) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for(uint8_t byte = 0; byte < 6; byte++)
+	{
+		indices |= (uint64_t)block[2 + byte] << (byte * 8);
+	}
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		texels[texel][3] = palette[(indices >> (texel * 3)) & 7];
+	}
+}
+
+// Reads count bits from a 128 bit block, least significant first.
+uint32_t texture_read_block_bits(uint8_t* block, uint32_t* position, uint32_t count)
+{
+	uint32_t value = 0;
+	for(uint32_t bit = 0; bit < count; bit++)
+	{
+		uint32_t block_bit = *position + bit;
+		value |= ((block[block_bit / 8] >> (block_bit % 8)) & 1) << bit;
+	}
+	*position += count;
+	return value;
+}
+
+const uint8_t texture_bc7_weights_2[4]  = { 0, 21, 43, 64 };
+const uint8_t texture_bc7_weights_3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const uint8_t texture_bc7_weights_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// The layout of each of the 8 BC7 modes. A mode's bits are, in order: the mode, partition,
+// rotation and index selection, then every endpoint's red, green, blue and alpha, then the
+// p-bits, which are the low bit of every component of an endpoint, then the indices.
+typedef struct
+{
+	uint8_t subsets_len;
+	uint8_t partition_bits;
+	uint8_t rotation_bits;
+	uint8_t index_selection_bits;
+	uint8_t color_bits;
+	// 0 if the mode has no alpha, which is then opaque.
+	uint8_t alpha_bits;
+	// Either one p-bit per endpoint, or one shared by both endpoints of a subset.
+	bool    endpoint_p_bits;
+	bool    shared_p_bits;
+	uint8_t index_bits;
+	// Modes 4 and 5 have a second set of indices, for alpha.
+	uint8_t secondary_index_bits;
+} TextureBc7Mode;
+
+const TextureBc7Mode texture_bc7_modes[8] =
+{
+	{ .subsets_len = 3, .partition_bits = 4, .color_bits = 4, .endpoint_p_bits = true, .index_bits = 3 },
+	{ .subsets_len = 2, .partition_bits = 6, .color_bits = 6, .shared_p_bits = true, .index_bits = 3 },
+	{ .subsets_len = 3, .partition_bits = 6, .color_bits = 5, .index_bits = 2 },
+	{ .subsets_len = 2, .partition_bits = 6, .color_bits = 7, .endpoint_p_bits = true, .index_bits = 2 },
+	{ .subsets_len = 1, .rotation_bits = 2, .index_selection_bits = 1, .color_bits = 5, .alpha_bits = 6, .index_bits = 2, .secondary_index_bits = 3 },
+	{ .subsets_len = 1, .rotation_bits = 2, .color_bits = 7, .alpha_bits = 8, .index_bits = 2, .secondary_index_bits = 2 },
+	{ .subsets_len = 1, .color_bits = 7, .alpha_bits = 7, .endpoint_p_bits = true, .index_bits = 4 },
+	{ .subsets_len = 2, .partition_bits = 6, .color_bits = 5, .alpha_bits = 5, .endpoint_p_bits = true, .index_bits = 2 }
+};
+
+// Which subset each texel of a block belongs to, 2 bits per texel with the first texel lowest.
+const uint32_t texture_bc7_partitions_2[64] =
+{
+	0x50505050, 0x40404040, 0x54545454, 0x54505040, 0x50404000, 0x55545450, 0x55545040, 0x54504000,
+	0x50400000, 0x55555450, 0x55544000, 0x54400000, 0x55555440, 0x55550000, 0x55555500, 0x55000000,
+	0x55150100, 0x00004054, 0x15010000, 0x00405054, 0x00004050, 0x15050100, 0x05010000, 0x40505054,
+	0x00404050, 0x05010100, 0x14141414, 0x05141450, 0x01155440, 0x00555500, 0x15014054, 0x05414150,
+	0x44444444, 0x55005500, 0x11441144, 0x05055050, 0x05500550, 0x11114444, 0x41144114, 0x44111144,
+	0x15055054, 0x01055040, 0x05041050, 0x05455150, 0x14414114, 0x50050550, 0x41411414, 0x00141400,
+	0x00041504, 0x00105410, 0x10541000, 0x04150400, 0x50410514, 0x41051450, 0x05415014, 0x14054150,
+	0x41050514, 0x41505014, 0x40011554, 0x54150140, 0x50505500, 0x00555050, 0x15151010, 0x54540404
+};
+
+const uint32_t texture_bc7_partitions_3[64] =
+{
+	0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+	0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+	0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+	0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+	0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+	0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+	0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+	0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254
+};
+
+// The texel of each subset but the first whose index is stored with one bit less, its top bit
+// being implied zero. The first subset's is always texel 0.
+const uint8_t texture_bc7_anchors_2[64] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+const uint8_t texture_bc7_anchors_3_second[64] =
+{
+	 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+	 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+	 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+	 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+};
+
+const uint8_t texture_bc7_anchors_3_third[64] =
+{
+	15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+	15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+	15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+	15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+};
+
+// Expands a component of the given precision to 8 bits by replicating its top bits.
+uint8_t texture_bc7_unquantize(uint32_t value, uint32_t bits)
+{
+	value <<= 8 - bits;
+	return value | (value >> bits);
+}
+
+uint8_t texture_bc7_interpolate(uint8_t endpoint_0, uint8_t endpoint_1, uint32_t index, uint32_t index_bits)
+{
+	uint8_t weight = index_bits == 2
+		? texture_bc7_weights_2[index]
+		: index_bits == 3 ? texture_bc7_weights_3[index] : texture_bc7_weights_4[index];
+	return ((64 - weight) * endpoint_0 + weight * endpoint_1 + 32) >> 6;
+}
+
+void texture_decode_bc7(uint8_t* block, uint8_t texels[16][4])
+{
+	// The mode is the number of zero bits before the first set one.
+	uint32_t mode_index = 0;
+	while(mode_index < 8 && (block[0] & (1 << mode_index)) == 0)
+	{
+		mode_index++;
+	}
+
+	// Blocks without a mode are reserved, and decode to transparent black.
+	if(mode_index == 8)
+	{
+		memset(texels, 0, 16 * 4);
+		return;
+	}
+
+	const TextureBc7Mode* mode = &texture_bc7_modes[mode_index];
+	uint32_t position        = mode_index + 1;
+	uint32_t partition       = texture_read_block_bits(block, &position, mode->partition_bits);
+	uint32_t rotation        = texture_read_block_bits(block, &position, mode->rotation_bits);
+	uint32_t index_selection = texture_read_block_bits(block, &position, mode->index_selection_bits);
+
+	uint8_t  endpoints[3][2][4];
+	uint32_t endpoints_len = mode->subsets_len * 2;
+	for(uint8_t channel = 0; channel < 4; channel++)
+	{
+		uint32_t bits = channel < 3 ? mode->color_bits : mode->alpha_bits;
+		for(uint32_t endpoint = 0; endpoint < endpoints_len; endpoint++)
+		{
+			endpoints[endpoint / 2][endpoint % 2][channel] = texture_read_block_bits(block, &position, bits);
+		}
+	}
+
+	uint32_t p_bits[3][2] = {};
+	for(uint32_t endpoint = 0; endpoint < endpoints_len && mode->endpoint_p_bits; endpoint++)
+	{
+		p_bits[endpoint / 2][endpoint % 2] = texture_read_block_bits(block, &position, 1);
+	}
+	for(uint32_t subset = 0; subset < mode->subsets_len && mode->shared_p_bits; subset++)
+	{
+		p_bits[subset][0] = texture_read_block_bits(block, &position, 1);
+		p_bits[subset][1] = p_bits[subset][0];
+	}
+
+	bool has_p_bits = mode->endpoint_p_bits || mode->shared_p_bits;
+	for(uint32_t endpoint = 0; endpoint < endpoints_len; endpoint++)
+	{
+		uint8_t* components = endpoints[endpoint / 2][endpoint % 2];
+		for(uint8_t channel = 0; channel < 4; channel++)
+		{
+			uint32_t bits = channel < 3 ? mode->color_bits : mode->alpha_bits;
+			if(bits == 0)
+			{
+				components[channel] = 255;
+				continue;
+			}
+
+			uint32_t value = components[channel];
+			if(has_p_bits)
+			{
+				value = (value << 1) | p_bits[endpoint / 2][endpoint % 2];
+				bits++;
+			}
+			components[channel] = texture_bc7_unquantize(value, bits);
+		}
+	}
+
+	uint32_t subsets    = 0;
+	uint32_t anchors[3] = { 0, 0, 0 };
+	if(mode->subsets_len == 2)
+	{
+		subsets    = texture_bc7_partitions_2[partition];
+		anchors[1] = texture_bc7_anchors_2[partition];
+	}
+	else if(mode->subsets_len == 3)
+	{
+		subsets    = texture_bc7_partitions_3[partition];
+		anchors[1] = texture_bc7_anchors_3_second[partition];
+		anchors[2] = texture_bc7_anchors_3_third[partition];
+	}
+
+	uint8_t indices[16];
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		uint32_t subset = (subsets >> (texel * 2)) & 3;
+		indices[texel] = texture_read_block_bits(block, &position, mode->index_bits - (texel == anchors[subset]));
+	}
+	uint8_t secondary_indices[16];
+	for(uint8_t texel = 0; texel < 16 && mode->secondary_index_bits > 0; texel++)
+	{
+		secondary_indices[texel] = texture_read_block_bits(block, &position, mode->secondary_index_bits - (texel == 0));
+	}
+
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		uint32_t subset = (subsets >> (texel * 2)) & 3;
+		uint8_t* endpoint_0 = endpoints[subset][0];
+		uint8_t* endpoint_1 = endpoints[subset][1];
+
+		// Without secondary indices, alpha shares the color's. Mode 4's index selection bit swaps
+		// which of its two sets goes to color and which to alpha.
+		uint32_t color_index      = indices[texel];
+		uint32_t color_index_bits = mode->index_bits;
+		uint32_t alpha_index      = color_index;
+		uint32_t alpha_index_bits = color_index_bits;
+		if(mode->secondary_index_bits > 0)
+		{
+			alpha_index      = secondary_indices[texel];
+			alpha_index_bits = mode->secondary_index_bits;
+		}
+		if(index_selection)
+		{
+			uint32_t index = color_index;
+			color_index = alpha_index;
+			alpha_index = index;
+
+			uint32_t index_bits = color_index_bits;
+			color_index_bits = alpha_index_bits;
+			alpha_index_bits = index_bits;
+		}
+
+		for(uint8_t channel = 0; channel < 3; channel++)
+		{
+			texels[texel][channel] = texture_bc7_interpolate(endpoint_0[channel], endpoint_1[channel], color_index, color_index_bits);
+		}
+		texels[texel][3] = texture_bc7_interpolate(endpoint_0[3], endpoint_1[3], alpha_index, alpha_index_bits);
+
+		// Rotation swaps alpha with red, green or blue, which lets modes 4 and 5 spend their
+		// separately indexed channel on a color instead.
+		if(rotation > 0)
+		{
+			uint8_t swap = texels[texel][rotation - 1];
+			texels[texel][rotation - 1] = texels[texel][3];
+			texels[texel][3] = swap;
+		}
+	}
+}
+
+void texture_decode_block(TextureFormat format, uint8_t* block, uint8_t texels[16][4])
+{
+	switch(format)
+	{
+		case TEXTURE_FORMAT_BC1:
+			texture_decode_bc1_colors(block, false, texels);
+			break;
+		case TEXTURE_FORMAT_BC3:
+			texture_decode_bc1_colors(block + 8, true, texels);
+			texture_decode_bc3_alpha(block, texels);
+			break;
+		case TEXTURE_FORMAT_BC7:
+			texture_decode_bc7(block, texels);
+			break;
+	}
+}
+
+// Decodes a level's blocks into tightly packed RGBA8 pixels.
+void texture_decode_level(TextureFormat format, uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* pixels)
+{
+	uint32_t block_size = texture_format_block_size(format);
+
+	for(uint32_t block_y = 0; block_y < height; block_y += 4)
+	{
+		for(uint32_t block_x = 0; block_x < width; block_x += 4)
+		{
+			uint8_t texels[16][4];
+			texture_decode_block(format, blocks, texels);
+			blocks += block_size;
+
+			for(uint32_t texel_y = 0; texel_y < 4 && block_y + texel_y < height; texel_y++)
+			{
+				for(uint32_t texel_x = 0; texel_x < 4 && block_x + texel_x < width; texel_x++)
+				{
+					memcpy(&pixels[((block_y + texel_y) * width + block_x + texel_x) * 4], texels[texel_y * 4 + texel_x], 4);
+				}
+			}
+		}
+	}
+}
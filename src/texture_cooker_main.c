@@ -0,0 +1,555 @@
+// Offline texture cooker. Converts an image into the cooked texture format described in texture.c:
+// a full mip chain, block compressed, so that the renderer can upload it without decoding anything.
+//
+// Usage: texture_cooker <input image> <output.texture> [bc1|bc3|bc7]
+//
+// Without a format, opaque images are cooked to BC1 and anything with alpha to BC7.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "panic.c"
+#include "texture.c"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_BMP
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#include "stb/stb_image.h"
+
+// Mip levels are filtered in linear space, and stored as sRGB.
+float texture_cooker_srgb_to_linear(uint8_t value)
+{
+	float normalized = value / 255.0f;
+	return normalized <= 0.04045f ? normalized / 12.92f : powf((normalized + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t texture_cooker_linear_to_srgb(float value)
+{
+	float normalized = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t)fminf(fmaxf(normalized * 255.0f + 0.5f, 0.0f), 255.0f);
+}
+
+// Box filters a linear RGBA level down into the next one. Odd edges reuse their last texel.
+void texture_cooker_downsample(float* src, uint32_t src_width, uint32_t src_height, float* dst, uint32_t dst_width, uint32_t dst_height)
+{
+	for(uint32_t y = 0; y < dst_height; y++)
+	{
+		uint32_t src_y[2] = { y * 2, y * 2 + 1 < src_height ? y * 2 + 1 : src_height - 1 };
+		for(uint32_t x = 0; x < dst_width; x++)
+		{
+			uint32_t src_x[2] = { x * 2, x * 2 + 1 < src_width ? x * 2 + 1 : src_width - 1 };
+			for(uint8_t channel = 0; channel < 4; channel++)
+			{
+				float sum = 0;
+				for(uint8_t sample = 0; sample < 4; sample++)
+				{
+					sum += src[(src_y[sample / 2] * src_width + src_x[sample % 2]) * 4 + channel];
+				}
+				dst[(y * dst_width + x) * 4 + channel] = sum * 0.25f;
+			}
+		}
+	}
+}
+
+// Gathers a 4x4 block of sRGB pixels, repeating the last row and column past the edges.
+void texture_cooker_fetch_block(uint8_t* pixels, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t texels[16][4])
+{
+	for(uint32_t texel_y = 0; texel_y < 4; texel_y++)
+	{
+		uint32_t y = block_y + texel_y < height ? block_y + texel_y : height - 1;
+		for(uint32_t texel_x = 0; texel_x < 4; texel_x++)
+		{
+			uint32_t x = block_x + texel_x < width ? block_x + texel_x : width - 1;
+			memcpy(texels[texel_y * 4 + texel_x], &pixels[(y * width + x) * 4], 4);
+		}
+	}
+}
+
+// Finds the two ends of the line through the texels which best fits them, in the first
+// channels_len channels: the principal axis, by power iteration on the covariance matrix, clipped
+// to the texels' extent along it.
+void texture_cooker_fit_endpoints(uint8_t texels[16][4], uint8_t channels_len, float endpoints[2][4])
+{
+	float mean[4] = {};
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		for(uint8_t channel = 0; channel < channels_len; channel++)
+		{
+			mean[channel] += texels[texel][channel] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		for(uint8_t row = 0; row < channels_len; row++)
+		{
+			for(uint8_t column = 0; column < channels_len; column++)
+			{
+				covariance[row][column] += (texels[texel][row] - mean[row]) * (texels[texel][column] - mean[column]);
+			}
+		}
+	}
+
+	float axis[4] = { 1, 1, 1, 1 };
+	for(uint8_t iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		float length  = 0;
+		for(uint8_t row = 0; row < channels_len; row++)
+		{
+			for(uint8_t column = 0; column < channels_len; column++)
+			{
+				next[row] += covariance[row][column] * axis[column];
+			}
+			length += next[row] * next[row];
+		}
+
+		// A flat block has no axis, and any axis will do.
+		if(length < 1e-6f)
+		{
+			break;
+		}
+		length = sqrtf(length);
+		for(uint8_t channel = 0; channel < channels_len; channel++)
+		{
+			axis[channel] = next[channel] / length;
+		}
+	}
+
+	float projection_min = INFINITY;
+	float projection_max = -INFINITY;
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		float projection = 0;
+		for(uint8_t channel = 0; channel < channels_len; channel++)
+		{
+			projection += (texels[texel][channel] - mean[channel]) * axis[channel];
+		}
+		projection_min = fminf(projection_min, projection);
+		projection_max = fmaxf(projection_max, projection);
+	}
+
+	for(uint8_t channel = 0; channel < channels_len; channel++)
+	{
+		endpoints[0][channel] = fminf(fmaxf(mean[channel] + axis[channel] * projection_max, 0), 255);
+		endpoints[1][channel] = fminf(fmaxf(mean[channel] + axis[channel] * projection_min, 0), 255);
+	}
+}
+
+uint32_t texture_cooker_distance(uint8_t* a, uint8_t* b, uint8_t channels_len)
+{
+	uint32_t distance = 0;
+	for(uint8_t channel = 0; channel < channels_len; channel++)
+	{
+		int32_t difference = a[channel] - b[channel];
+		distance += difference * difference;
+	}
+	return distance;
+}
+
+uint8_t texture_cooker_nearest(uint8_t* texel, uint8_t (*palette)[4], uint8_t palette_len, uint8_t channels_len)
+{
+	uint8_t  nearest          = 0;
+	uint32_t nearest_distance = UINT32_MAX;
+	for(uint8_t entry = 0; entry < palette_len; entry++)
+	{
+		uint32_t distance = texture_cooker_distance(texel, palette[entry], channels_len);
+		if(distance < nearest_distance)
+		{
+			nearest          = entry;
+			nearest_distance = distance;
+		}
+	}
+	return nearest;
+}
+
+uint16_t texture_cooker_rgb565(float* color)
+{
+	uint16_t red   = (uint16_t)(color[0] * 31.0f / 255.0f + 0.5f);
+	uint16_t green = (uint16_t)(color[1] * 63.0f / 255.0f + 0.5f);
+	uint16_t blue  = (uint16_t)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (red << 11) | (green << 5) | blue;
+}
+
+// Always in four color mode, which BC3 requires and which opaque BC1 blocks want anyway.
+void texture_cooker_encode_bc1_colors(uint8_t texels[16][4], uint8_t* block)
+{
+	float endpoints[2][4];
+	texture_cooker_fit_endpoints(texels, 3, endpoints);
+
+	uint16_t color_0 = texture_cooker_rgb565(endpoints[0]);
+	uint16_t color_1 = texture_cooker_rgb565(endpoints[1]);
+	if(color_0 < color_1)
+	{
+		uint16_t swap = color_0;
+		color_0 = color_1;
+		color_1 = swap;
+	}
+
+	block[0] = color_0 & 0xff;
+	block[1] = color_0 >> 8;
+	block[2] = color_1 & 0xff;
+	block[3] = color_1 >> 8;
+
+	// Equal endpoints would put a BC1 block into three color mode, where index 3 is transparent,
+	// so they only ever use index 0.
+	uint32_t indices = 0;
+	if(color_0 != color_1)
+	{
+		// Decoding a block whose first four texels use indices 0 to 3 yields the palette.
+		uint8_t palette[16][4];
+		block[4] = 0xe4;
+		block[5] = 0;
+		block[6] = 0;
+		block[7] = 0;
+		texture_decode_bc1_colors(block, true, palette);
+		for(uint8_t texel = 0; texel < 16; texel++)
+		{
+			indices |= (uint32_t)texture_cooker_nearest(texels[texel], palette, 4, 3) << (texel * 2);
+		}
+	}
+
+	block[4] = indices & 0xff;
+	block[5] = (indices >> 8) & 0xff;
+	block[6] = (indices >> 16) & 0xff;
+	block[7] = indices >> 24;
+}
+
+void texture_cooker_encode_bc3_alpha(uint8_t texels[16][4], uint8_t* block)
+{
+	uint8_t alpha_min = 255;
+	uint8_t alpha_max = 0;
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		alpha_min = texels[texel][3] < alpha_min ? texels[texel][3] : alpha_min;
+		alpha_max = texels[texel][3] > alpha_max ? texels[texel][3] : alpha_max;
+	}
+
+	// The larger endpoint first selects eight interpolated values. With both equal, every index
+	// decodes to the same value anyway.
+	block[0] = alpha_max;
+	block[1] = alpha_min;
+
+	// Decoding a block whose first eight texels use indices 0 to 7 yields the palette.
+	uint64_t indices = 0;
+	for(uint8_t entry = 0; entry < 8; entry++)
+	{
+		indices |= (uint64_t)entry << (entry * 3);
+	}
+	for(uint8_t byte = 0; byte < 6; byte++)
+	{
+		block[2 + byte] = (indices >> (byte * 8)) & 0xff;
+	}
+
+	uint8_t palette[16][4];
+	texture_decode_bc3_alpha(block, palette);
+
+	indices = 0;
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		uint8_t  nearest          = 0;
+		uint32_t nearest_distance = UINT32_MAX;
+		for(uint8_t entry = 0; entry < 8; entry++)
+		{
+			int32_t  difference = palette[entry][3] - texels[texel][3];
+			uint32_t distance   = difference * difference;
+			if(distance < nearest_distance)
+			{
+				nearest          = entry;
+				nearest_distance = distance;
+			}
+		}
+		indices |= (uint64_t)nearest << (texel * 3);
+	}
+
+	for(uint8_t byte = 0; byte < 6; byte++)
+	{
+		block[2 + byte] = (indices >> (byte * 8)) & 0xff;
+	}
+}
+
+// Writes count bits of value into a 128 bit block, least significant first.
+void texture_cooker_write_block_bits(uint8_t* block, uint32_t* position, uint32_t value, uint32_t count)
+{
+	for(uint32_t bit = 0; bit < count; bit++)
+	{
+		uint32_t block_bit = *position + bit;
+		block[block_bit / 8] |= ((value >> bit) & 1) << (block_bit % 8);
+	}
+	*position += count;
+}
+
+// Mode 6 only: one subset with 7 bit RGBA endpoints plus a shared low bit each, and 4 bit indices.
+// It handles both opaque and alpha blocks well, at a fraction of a full mode search's cost.
+void texture_cooker_encode_bc7(uint8_t texels[16][4], uint8_t* block)
+{
+	float endpoints[2][4];
+	texture_cooker_fit_endpoints(texels, 4, endpoints);
+
+	// Quantize each endpoint, picking whichever low bit lands closer.
+	uint8_t quantized[2][4];
+	uint8_t p_bits[2];
+	for(uint8_t endpoint = 0; endpoint < 2; endpoint++)
+	{
+		float best_error = INFINITY;
+		for(uint8_t p_bit = 0; p_bit < 2; p_bit++)
+		{
+			uint8_t candidate[4];
+			float   error = 0;
+			for(uint8_t channel = 0; channel < 4; channel++)
+			{
+				float value = roundf((endpoints[endpoint][channel] - p_bit) / 2.0f);
+				candidate[channel] = (uint8_t)fminf(fmaxf(value, 0), 127);
+
+				float difference = ((candidate[channel] << 1) | p_bit) - endpoints[endpoint][channel];
+				error += difference * difference;
+			}
+			if(error < best_error)
+			{
+				best_error = error;
+				memcpy(quantized[endpoint], candidate, 4);
+				p_bits[endpoint] = p_bit;
+			}
+		}
+	}
+
+	uint8_t palette[16][4];
+	for(uint8_t entry = 0; entry < 16; entry++)
+	{
+		uint8_t weight = texture_bc7_weights_4[entry];
+		for(uint8_t channel = 0; channel < 4; channel++)
+		{
+			uint8_t endpoint_0 = (quantized[0][channel] << 1) | p_bits[0];
+			uint8_t endpoint_1 = (quantized[1][channel] << 1) | p_bits[1];
+			palette[entry][channel] = ((64 - weight) * endpoint_0 + weight * endpoint_1 + 32) >> 6;
+		}
+	}
+
+	uint8_t indices[16];
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		indices[texel] = texture_cooker_nearest(texels[texel], palette, 16, 4);
+	}
+
+	// The first index is stored without its top bit, so it has to be below 8. Swapping the
+	// endpoints mirrors every index.
+	if(indices[0] >= 8)
+	{
+		for(uint8_t channel = 0; channel < 4; channel++)
+		{
+			uint8_t swap = quantized[0][channel];
+			quantized[0][channel] = quantized[1][channel];
+			quantized[1][channel] = swap;
+		}
+		uint8_t swap = p_bits[0];
+		p_bits[0] = p_bits[1];
+		p_bits[1] = swap;
+
+		for(uint8_t texel = 0; texel < 16; texel++)
+		{
+			indices[texel] = 15 - indices[texel];
+		}
+	}
+
+	memset(block, 0, 16);
+	uint32_t position = 0;
+	texture_cooker_write_block_bits(block, &position, 1 << 6, 7);
+	for(uint8_t channel = 0; channel < 4; channel++)
+	{
+		texture_cooker_write_block_bits(block, &position, quantized[0][channel], 7);
+		texture_cooker_write_block_bits(block, &position, quantized[1][channel], 7);
+	}
+	texture_cooker_write_block_bits(block, &position, p_bits[0], 1);
+	texture_cooker_write_block_bits(block, &position, p_bits[1], 1);
+	for(uint8_t texel = 0; texel < 16; texel++)
+	{
+		texture_cooker_write_block_bits(block, &position, indices[texel], texel == 0 ? 3 : 4);
+	}
+}
+
+void texture_cooker_encode_level(TextureFormat format, uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks)
+{
+	uint32_t block_size = texture_format_block_size(format);
+
+	for(uint32_t block_y = 0; block_y < height; block_y += 4)
+	{
+		for(uint32_t block_x = 0; block_x < width; block_x += 4)
+		{
+			uint8_t texels[16][4];
+			texture_cooker_fetch_block(pixels, width, height, block_x, block_y, texels);
+
+			switch(format)
+			{
+				case TEXTURE_FORMAT_BC1:
+					texture_cooker_encode_bc1_colors(texels, blocks);
+					break;
+				case TEXTURE_FORMAT_BC3:
+					texture_cooker_encode_bc3_alpha(texels, blocks);
+					texture_cooker_encode_bc1_colors(texels, blocks + 8);
+					break;
+				case TEXTURE_FORMAT_BC7:
+					texture_cooker_encode_bc7(texels, blocks);
+					break;
+			}
+			blocks += block_size;
+		}
+	}
+}
+
+void texture_cooker_write_padding(FILE* file, uint64_t* offset)
+{
+	static const uint8_t zeros[TEXTURE_FILE_LEVEL_ALIGNMENT] = {};
+
+	uint64_t aligned = texture_file_align(*offset);
+	if(fwrite(zeros, 1, aligned - *offset, file) != aligned - *offset)
+	{
+		panic();
+	}
+	*offset = aligned;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	if(argc != 3 && argc != 4)
+	{
+		printf("Usage: %s <input image> <output.texture> [bc1|bc3|bc7]\n", argv[0]);
+		return 1;
+	}
+
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+	uint8_t* pixels = stbi_load(argv[1], &width, &height, &channels, STBI_rgb_alpha);
+	if(!pixels)
+	{
+		printf("Failed to load image file: %s\n", argv[1]);
+		return 1;
+	}
+
+	bool opaque = true;
+	for(uint64_t pixel = 0; pixel < (uint64_t)width * height; pixel++)
+	{
+		opaque = opaque && pixels[pixel * 4 + 3] == 255;
+	}
+
+	TextureFormat format = opaque ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC7;
+	if(argc == 4)
+	{
+		if(strcmp(argv[3], "bc1") == 0)
+		{
+			format = TEXTURE_FORMAT_BC1;
+		}
+		else if(strcmp(argv[3], "bc3") == 0)
+		{
+			format = TEXTURE_FORMAT_BC3;
+		}
+		else if(strcmp(argv[3], "bc7") == 0)
+		{
+			format = TEXTURE_FORMAT_BC7;
+		}
+		else
+		{
+			printf("Unknown texture format: %s\n", argv[3]);
+			return 1;
+		}
+	}
+
+	TextureFileHeader header =
+	{
+		.magic      = TEXTURE_FILE_MAGIC,
+		.version    = TEXTURE_FILE_VERSION,
+		.format     = format,
+		.width      = width,
+		.height     = height,
+		.mip_levels = texture_full_mip_levels(width, height)
+	};
+	if(header.mip_levels > TEXTURE_FILE_LEVELS_MAX)
+	{
+		printf("Image is too large to cook: %s\n", argv[1]);
+		return 1;
+	}
+
+	uint64_t offset = texture_file_align(sizeof(TextureFileHeader));
+	for(uint32_t level = 0; level < header.mip_levels; level++)
+	{
+		header.levels[level].offset = offset;
+		header.levels[level].size   = texture_level_size(format, texture_level_dimension(width, level), texture_level_dimension(height, level));
+		offset = texture_file_align(offset + header.levels[level].size);
+	}
+
+	FILE* file = fopen(argv[2], "wb");
+	if(file == NULL)
+	{
+		printf("Failed to open file: %s\n", argv[2]);
+		return 1;
+	}
+
+	offset = 0;
+	if(fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		panic();
+	}
+	offset += sizeof(header);
+
+	// Each level is filtered from the previous one in linear space, then encoded from its sRGB
+	// pixels.
+	uint64_t pixels_len = (uint64_t)width * height;
+	float*   linear     = malloc(pixels_len * 4 * sizeof(float));
+	float*   next       = malloc(pixels_len * 4 * sizeof(float));
+	uint8_t* blocks     = malloc(header.levels[0].size);
+	if(!linear || !next || !blocks)
+	{
+		panic();
+	}
+	for(uint64_t component = 0; component < pixels_len * 4; component++)
+	{
+		linear[component] = component % 4 == 3 ? pixels[component] / 255.0f : texture_cooker_srgb_to_linear(pixels[component]);
+	}
+
+	for(uint32_t level = 0; level < header.mip_levels; level++)
+	{
+		uint32_t level_width  = texture_level_dimension(width, level);
+		uint32_t level_height = texture_level_dimension(height, level);
+
+		if(level > 0)
+		{
+			texture_cooker_downsample(linear, texture_level_dimension(width, level - 1), texture_level_dimension(height, level - 1), next, level_width, level_height);
+			float* swap = linear;
+			linear = next;
+			next   = swap;
+
+			for(uint64_t component = 0; component < (uint64_t)level_width * level_height * 4; component++)
+			{
+				pixels[component] = component % 4 == 3
+					? (uint8_t)fminf(fmaxf(linear[component] * 255.0f + 0.5f, 0), 255)
+					: texture_cooker_linear_to_srgb(linear[component]);
+			}
+		}
+
+		texture_cooker_encode_level(format, pixels, level_width, level_height, blocks);
+
+		texture_cooker_write_padding(file, &offset);
+		if(fwrite(blocks, 1, header.levels[level].size, file) != header.levels[level].size)
+		{
+			panic();
+		}
+		offset += header.levels[level].size;
+	}
+
+	fclose(file);
+	free(blocks);
+	free(next);
+	free(linear);
+	stbi_image_free(pixels);
+
+	char* format_names[] = { "", "BC1", "BC3", "BC7" };
+	printf("Cooked %s: %ux%u %s, %u levels, %lu bytes (%lu uncompressed)\n",
+		argv[2], width, height, format_names[format], header.mip_levels, offset, pixels_len * 4 * 4 / 3);
+	return 0;
+}
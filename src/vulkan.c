@@ -1,25 +1,91 @@
 #define VK_DEBUG 1
 
 #define PIPELINES_COUNT        1
-#define MESHES_COUNT           1
+// Upper bound on unique meshes, which can be fewer than MESH_ASSETS_LEN as identical assets share one.
+// VOLATILE - compile_shaders.sh passes MESH_ASSETS_LEN to world_cull.comp as MESHES_COUNT.
+#define MESHES_COUNT           MESH_ASSETS_LEN
 #define SWAPCHAIN_IMAGES_COUNT 4
 
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_ONLY_BMP
-#include "stb/stb_image.h"
-
-// TODO - Load models ourselves, presumably once we decide on what format(s) we are using.
-#define TINYOBJ_LOADER_C_IMPLEMENTATION
-#include "tinyobj_loader_c/tinyobj_loader_c.h"
+// Relative to the working directory, like the assets.
+#define VULKAN_PIPELINE_CACHE_PATH "pipeline_cache.bin"
+// Upper bound on unique .spv files across every pipeline.
+#define VULKAN_SHADER_MODULES_MAX  16
+
+// Pipelines compile on up to this many worker threads, one per core.
+#define VULKAN_PIPELINE_WORKERS_MAX         8
+#define VULKAN_PIPELINE_JOBS_MAX            16
+#define VULKAN_VERTEX_INPUT_ATTRIBUTES_MAX  8
+
+// How many frames the CPU is allowed to record ahead of the GPU. 2 or 3 are sensible values; higher
+// values trade latency for smoothing over frame time spikes.
+#define FRAMES_IN_FLIGHT_COUNT 2
+
+// Device memory is sub-allocated from blocks of this size. Heaps of 1GB or less use an eighth of the
+// heap instead, and resources that don't fit in a block get a dedicated one.
+#define VULKAN_MEMORY_BLOCK_SIZE              (64 * 1024 * 1024)
+#define VULKAN_MEMORY_SMALL_HEAP_SIZE         (1024 * 1024 * 1024)
+#define VULKAN_MEMORY_BLOCKS_MAX              64
+#define VULKAN_MEMORY_BLOCK_FREE_RANGES_MAX   128
+
+// Uploads are written through a persistently mapped staging ring of this size, which is reclaimed
+// as the transfer queue's timeline semaphore advances. An upload which doesn't fit waits for a later
+// frame, so this bounds how much upload data can be in flight at once.
+#define VULKAN_STAGING_RING_SIZE       (32 * 1024 * 1024)
+#define VULKAN_STAGING_ALIGNMENT       16
+#define VULKAN_STAGING_REGIONS_MAX     16
+#define VULKAN_TRANSFER_BATCHES_COUNT  4
+// Buffer ranges released by the transfer queue which the graphics queue has yet to acquire.
+#define VULKAN_BUFFER_ACQUIRES_MAX     16
+
+// Texture 0 is a placeholder which is uploaded during initialization, and is sampled in place of
+// any texture which is still streaming in. Every other texture belongs to the material asset one
+// below it.
+#define TEXTURES_COUNT             (MATERIAL_ASSETS_LEN + 1)
+#define VULKAN_PLACEHOLDER_TEXTURE 0
+// Size of the world pipeline's texture array, which is indexed by texture. Only the slots of
+// resident textures are ever written, so this only needs to be an upper bound on TEXTURES_COUNT.
+// Devices supporting the descriptor indexing features we need allow at least 500000.
+#define VULKAN_BINDLESS_TEXTURES_MAX 4096
+
+// Barriers a VulkanBarrierBatch holds before it has to be flushed.
+#define VULKAN_BARRIER_BATCH_IMAGES_MAX        32
+#define VULKAN_BARRIER_BATCH_BUFFERS_MAX       32
+
+// Per frame limits of the render graph. Graph images are the transient attachments, which persist
+// across frames and are shared by transients that aren't alive at the same time.
+#define VULKAN_RENDER_GRAPH_PASSES_MAX         16
+#define VULKAN_RENDER_GRAPH_RESOURCES_MAX      16
+#define VULKAN_RENDER_GRAPH_PASS_ACCESSES_MAX  8
+#define VULKAN_RENDER_GRAPH_IMAGES_MAX         8
+
+// Swapchains replaced by a resize wait this many at a time for their frames to retire before being
+// destroyed. Past that, recreation waits for the device instead.
+#define VULKAN_RETIRED_SWAPCHAINS_MAX          4
+
+// VOLATILE - Must match local_size_x in world_cull.comp.
+#define CULL_WORKGROUP_SIZE    64
+
+#include "mesh.c"
+#include "texture.c"
 
 #include "vulkan_verify.c"
 #include "vulkan_context.c"
 #include "vulkan_allocate.c"
-#include "vulkan_transient_commands.c"
-#include "vulkan_image_memory_barrier.c"
+#include "vulkan_barrier_batch.c"
+#include "vulkan_mipmap.c"
 #include "vulkan_image_view.c"
 #include "vulkan_mesh.c"
+#include "vulkan_texture.c"
+#include "vulkan_pipeline_cache.c"
+#include "vulkan_shader_module.c"
 #include "vulkan_pipeline.c"
+#include "vulkan_pipeline_builder.c"
+#include "vulkan_staging_ring.c"
+#include "vulkan_transfer.c"
+#include "vulkan_texture_stream.c"
+#include "vulkan_render_graph.c"
+#include "vulkan_retired_swapchain.c"
+#include "vulkan_msaa.c"
 
 typedef struct
 {
@@ -29,29 +95,17 @@ typedef struct
 	uint8_t window_extensions_len;
 } VulkanPlatform;
 
-void vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
+// Returns false without touching the current swapchain if the surface has no area, as when the
+// window is minimized, in which case there is nothing to render to until it is recreated.
+bool vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
 {
 	// This function is being called in one of two situations:
 	// 1. During program initialization.
 	// 2. The platform surface has changed and swapchain related information is no longer valid.
-	if(recreate)
-	{
-		vkDeviceWaitIdle(ctx->device);
-
-		for(uint8_t image_index = 0; image_index < SWAPCHAIN_IMAGES_COUNT; image_index++)
-		{
-			vkDestroyImageView(ctx->device, ctx->swapchain_image_views[image_index], 0);
-		}
-
-		vkDestroySwapchainKHR(ctx->device, ctx->swapchain, 0);
-
-		vkDestroyImage(ctx->device, ctx->render_image.image, 0);
-		vkDestroyImageView(ctx->device, ctx->render_image.view, 0);
-		vkFreeMemory(ctx->device, ctx->render_image.memory, 0);
-
-		vkDestroySemaphore(ctx->device, ctx->image_available_semaphore, 0);
-		vkDestroySemaphore(ctx->device, ctx->render_finished_semaphore, 0);
-	}
+	//
+	// When recreating, the old swapchain is handed to the new one as oldSwapchain and then retired
+	// along with its views, rather than waiting for the device to go idle. See
+	// vulkan_retired_swapchain.c.
 
 	// Query surface capabilities to give us the following info:
 	// - The transform of the surface (believe the position on screen, roughly speaking?)
@@ -65,8 +119,16 @@ void vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
 
 	VkSurfaceTransformFlagBitsKHR surface_pre_transform = surface_capabilities.currentTransform;
 
-	ctx->swapchain_extent.width  = surface_capabilities.maxImageExtent.width;
-	ctx->swapchain_extent.height = surface_capabilities.maxImageExtent.height;
+	// The surface's current extent is the window's, unless the surface is sized by the swapchain.
+	VkExtent2D extent = surface_capabilities.currentExtent;
+	if(extent.width == UINT32_MAX)
+	{
+		extent = surface_capabilities.maxImageExtent;
+	}
+	if(extent.width == 0 || extent.height == 0)
+	{
+		return false;
+	}
 
 	// CONSIDER - Not sure exactly what this logic is for. Look at it a little closer.
 	uint32_t swapchain_image_count = surface_capabilities.minImageCount + 1;
@@ -130,7 +192,7 @@ void vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
 		.minImageCount         = swapchain_image_count, 
 		.imageFormat           = ctx->surface_format.format,
 		.imageColorSpace       = ctx->surface_format.colorSpace,
-		.imageExtent           = ctx->swapchain_extent,
+		.imageExtent           = extent,
 		.imageArrayLayers      = 1,
 		.imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE,
@@ -140,59 +202,45 @@ void vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
 		.compositeAlpha        = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
 		.presentMode           = present_mode,
 		.clipped               = VK_TRUE,
-		.oldSwapchain          = 0
+		.oldSwapchain          = recreate ? ctx->swapchain : VK_NULL_HANDLE
 	};
 
-	vk_verify(vkCreateSwapchainKHR(ctx->device, &swapchain_create_info, 0, &ctx->swapchain));
+	VkSwapchainKHR swapchain;
+	vk_verify(vkCreateSwapchainKHR(ctx->device, &swapchain_create_info, 0, &swapchain));
+
+	// Render graph images which are still the right size are kept, the rest are recreated at the
+	// new extent the next time they are used.
+	if(recreate)
+	{
+		vulkan_retire_swapchain(ctx, extent);
+	}
+	ctx->swapchain        = swapchain;
+	ctx->swapchain_extent = extent;
 
 	// Get references to the swapchain images.
-	uint32_t swapchain_images_count = SWAPCHAIN_IMAGES_COUNT;
 	vk_verify(vkGetSwapchainImagesKHR(
 		ctx->device, 
 		ctx->swapchain, 
-		&swapchain_images_count, 
+		&ctx->swapchain_images_len, 
 		0));
+	if(ctx->swapchain_images_len > SWAPCHAIN_IMAGES_COUNT)
+	{
+		panic();
+	}
 	vk_verify(vkGetSwapchainImagesKHR(
 		ctx->device, 
 		ctx->swapchain, 
-		&swapchain_images_count, 
+		&ctx->swapchain_images_len, 
 		ctx->swapchain_images));
 
-	// Allocate resources for render and depth images.
-	//
-	// CONSIDER - The following description is a bit lacking in understanding.
-	// The render image is used in the rendering pipeline, and is transferred to the swapchain.
-	vulkan_allocate_image(
-		ctx,
-		&ctx->render_image,
-		ctx->swapchain_extent,
-		ctx->surface_format.format,
-		ctx->device_framebuffer_sample_counts,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
-
-	vulkan_allocate_image(
-		ctx, 
-		&ctx->depth_image,
-		ctx->swapchain_extent,
-		VK_FORMAT_D32_SFLOAT,
-		ctx->device_framebuffer_sample_counts,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-	vulkan_create_image_view(
-		ctx,
-		&ctx->render_image.image,
-		&ctx->render_image.view,
-		ctx->surface_format.format,
-		VK_IMAGE_ASPECT_COLOR_BIT);
-
-	vulkan_create_image_view(
-		ctx,
-		&ctx->depth_image.image,
-		&ctx->depth_image.view,
-		VK_FORMAT_D32_SFLOAT,
-		VK_IMAGE_ASPECT_DEPTH_BIT);
+	VkSemaphoreCreateInfo semaphore_create_info =
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = 0,
+		.flags = 0
+	};
 
-	for(uint32_t image_index = 0; image_index < SWAPCHAIN_IMAGES_COUNT; image_index++)
+	for(uint32_t image_index = 0; image_index < ctx->swapchain_images_len; image_index++)
 	{
 		vulkan_create_image_view(
 			ctx,
@@ -200,21 +248,9 @@ void vulkan_initialize_swapchain(VulkanContext* ctx, bool recreate)
 			&ctx->swapchain_image_views[image_index],
 			ctx->surface_format.format,
 			VK_IMAGE_ASPECT_COLOR_BIT);
+		vk_verify(vkCreateSemaphore(ctx->device, &semaphore_create_info, 0, &ctx->swapchain_render_finished_semaphores[image_index]));
 	}
-
-	// Create synchonization primitives.
-	//
-	// This needs to happen every time the swapchain is recreated because otherwise semaphores
-	// could be in a now invalid state(terminology?).
-	VkSemaphoreCreateInfo semaphore_create_info =
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-		.pNext = 0,
-		.flags = 0
-	};
-
-	vk_verify(vkCreateSemaphore(ctx->device, &semaphore_create_info, 0, &ctx->image_available_semaphore));
-	vk_verify(vkCreateSemaphore(ctx->device, &semaphore_create_info, 0, &ctx->render_finished_semaphore));
+	return true;
 }
 
 void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
@@ -286,9 +322,10 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 	{
 		VkPhysicalDevice   handle;
 		uint8_t            score;
-		VkSampleCountFlags framebuffer_color_sample_counts;
+		VkSampleCountFlags framebuffer_sample_counts;
 		uint32_t           graphics_family_index;
 		uint32_t           present_family_index;
+		uint32_t           transfer_family_index;
 		float              max_sampler_anisotropy;
 	} PhysicalDeviceCandidate;
 
@@ -344,6 +381,20 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 			continue;
 		}
 
+		// A family which can transfer but neither draw nor dispatch is usually backed by dedicated
+		// copy engines, which lets uploads run alongside rendering. Without one, uploads go through
+		// the graphics queue.
+		candidate.transfer_family_index = candidate.graphics_family_index;
+		for(uint32_t queue_index = 0; queue_index < queue_families_len; queue_index++)
+		{
+			VkQueueFlags queue_flags = queue_family_properties[queue_index].queueFlags;
+			if((queue_flags & VK_QUEUE_TRANSFER_BIT) && !(queue_flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			{
+				candidate.transfer_family_index = queue_index;
+				break;
+			}
+		}
+
 		// Criteria: extensions
 		// - MUST have KHR_SWAPCHAIN and KHR_DYNAMIC_RENDERING extensions
 		uint32_t extensions_len;
@@ -377,6 +428,9 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 
 		// Criteria: device features
 		// - Features MUST include samplerAnisotropy.
+		//
+		// Culled draws don't need drawIndirectFirstInstance, as each draw pushes its first visible
+		// instance as a push constant instead.
 		VkPhysicalDeviceFeatures device_features;
 		vkGetPhysicalDeviceFeatures(candidate.handle, &device_features);
 		if(device_features.samplerAnisotropy != VK_TRUE)
@@ -384,74 +438,122 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 			continue;
 		}
 
-		// Criteria: properties
-		// - +1 points for each framebufferColorSampleCounts flag above VK_SAMPLE_COUNT_1_BIT
-		VkPhysicalDeviceProperties properties;
-		vkGetPhysicalDeviceProperties(candidate.handle, &properties);
+		// - Features MUST include timelineSemaphore, which tracks upload completion.
+		VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features =
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+			.pNext = 0
+		};
+		vkGetPhysicalDeviceFeatures2(candidate.handle, &(VkPhysicalDeviceFeatures2)
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &timeline_semaphore_features
+		});
+		if(timeline_semaphore_features.timelineSemaphore != VK_TRUE)
+		{
+			continue;
+		}
 
-		candidate.framebuffer_color_sample_counts = properties.limits.framebufferColorSampleCounts;
-		VkSampleCountFlags sample_count_options[7] = 
+		// - Features MUST include the descriptor indexing features behind the world pipeline's
+		//   texture array, which is sparsely written as textures stream in and indexed per material.
+		VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features =
 		{
-			VK_SAMPLE_COUNT_64_BIT,
-			VK_SAMPLE_COUNT_32_BIT, 
-			VK_SAMPLE_COUNT_16_BIT, 
-			VK_SAMPLE_COUNT_8_BIT, 
-			VK_SAMPLE_COUNT_4_BIT, 
-			VK_SAMPLE_COUNT_2_BIT
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+			.pNext = 0
 		};
-		for(uint8_t samples_index = 0; samples_index < 7; samples_index++)
+		vkGetPhysicalDeviceFeatures2(candidate.handle, &(VkPhysicalDeviceFeatures2)
 		{
-			if(candidate.framebuffer_color_sample_counts & sample_count_options[samples_index])
-			{
-				candidate.framebuffer_color_sample_counts = sample_count_options[samples_index];
-				candidate.score += 7 - samples_index;
-				break;
-			}
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &descriptor_indexing_features
+		});
+		if(descriptor_indexing_features.runtimeDescriptorArray != VK_TRUE
+			|| descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing != VK_TRUE
+			|| descriptor_indexing_features.descriptorBindingPartiallyBound != VK_TRUE
+			|| descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE
+			|| descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending != VK_TRUE)
+		{
+			continue;
+		}
+
+		// - Features MUST include synchronization2, which every barrier is recorded with.
+		VkPhysicalDeviceSynchronization2Features synchronization2_features =
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+			.pNext = 0
+		};
+		vkGetPhysicalDeviceFeatures2(candidate.handle, &(VkPhysicalDeviceFeatures2)
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &synchronization2_features
+		});
+		if(synchronization2_features.synchronization2 != VK_TRUE)
+		{
+			continue;
 		}
 
+		// Criteria: properties
+		// - Sample counts don't count towards the score, as MSAA is a quality setting. The spec
+		//   guarantees 4x, and tiers above what a device supports fall back to lower counts.
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate.handle, &properties);
+
+		candidate.framebuffer_sample_counts = 
+			properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+
 		// While we are at it, store our max_sampler_anisotropy value.
 		// CONSIDER - Include this in device score?
 		candidate.max_sampler_anisotropy = properties.limits.maxSamplerAnisotropy;
 
-		if(candidate.score > best_physical_device.score)
+		if(best_physical_device.handle == VK_NULL_HANDLE || candidate.score > best_physical_device.score)
 		{
 			best_physical_device = candidate;
 		}
 	}
-	if(best_physical_device.score == 0)
+	if(best_physical_device.handle == VK_NULL_HANDLE)
 	{
 		panic();
 	}
 
 	ctx->physical_device = best_physical_device.handle;
 	ctx->device_max_sampler_anisotropy    = best_physical_device.max_sampler_anisotropy;
-	ctx->device_framebuffer_sample_counts = best_physical_device.framebuffer_color_sample_counts;
+	ctx->device_framebuffer_sample_counts = best_physical_device.framebuffer_sample_counts;
+	ctx->msaa_samples                     = vulkan_msaa_tier_samples(ctx, MSAA_TIER_DEFAULT);
+	ctx->depth_prepass                    = false;
 
 	// Create logical device queues.
-	uint32_t queue_family_indices[2] = 
+	uint32_t queue_family_indices[3] = 
 	{ 
 		best_physical_device.graphics_family_index,
-		best_physical_device.present_family_index
+		best_physical_device.present_family_index,
+		best_physical_device.transfer_family_index
 	};
 
-	uint8_t queue_create_infos_len = 2;
-	// Present and graphics could be in the same queue.
-	if(best_physical_device.graphics_family_index == best_physical_device.present_family_index)
-	{
-		queue_create_infos_len = 1;
-	}
-
-	VkDeviceQueueCreateInfo queue_create_infos[queue_create_infos_len];
+	// Graphics, present and transfer could share families, which only get one queue each.
+	VkDeviceQueueCreateInfo queue_create_infos[3];
+	uint8_t queue_create_infos_len = 0;
 
 	float queue_priority = 1;
-	for(uint8_t queue_index = 0; queue_index < queue_create_infos_len; queue_index++)
+	for(uint8_t family_index = 0; family_index < 3; family_index++)
 	{
-		queue_create_infos[queue_index] = (VkDeviceQueueCreateInfo)
+		bool family_seen = false;
+		for(uint8_t queue_index = 0; queue_index < queue_create_infos_len; queue_index++)
+		{
+			if(queue_create_infos[queue_index].queueFamilyIndex == queue_family_indices[family_index])
+			{
+				family_seen = true;
+			}
+		}
+		if(family_seen)
+		{
+			continue;
+		}
+
+		queue_create_infos[queue_create_infos_len++] = (VkDeviceQueueCreateInfo)
 		{
 			.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
 			.pNext            = 0,
 			.flags            = 0,
-			.queueFamilyIndex = queue_family_indices[queue_index],
+			.queueFamilyIndex = queue_family_indices[family_index],
 			.queueCount       = 1,
 			.pQueuePriorities = &queue_priority,
 		};
@@ -464,7 +566,21 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 		.pNext = &(VkPhysicalDeviceDynamicRenderingFeatures)
 		{
 			.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES,
-			.pNext            = 0,
+			.pNext            = &(VkPhysicalDeviceTimelineSemaphoreFeatures)
+			{
+				.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+				.pNext             = &(VkPhysicalDeviceDescriptorIndexingFeatures)
+				{
+					.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+					.pNext = &(VkPhysicalDeviceSynchronization2Features)
+					{
+						.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+						.pNext            = 0,
+						.synchronization2 = VK_TRUE
+					}
+				},
+				.timelineSemaphore = VK_TRUE
+			},
 			.dynamicRendering = VK_TRUE
 		},
 		.features = {}
@@ -486,31 +602,56 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 	};
 	vk_verify(vkCreateDevice(ctx->physical_device, &device_create_info, 0, &ctx->device));
 
+	vulkan_initialize_memory_allocator(ctx);
+
 	vkGetDeviceQueue(ctx->device, best_physical_device.graphics_family_index, 0, &ctx->graphics_queue);
 	vkGetDeviceQueue(ctx->device, best_physical_device.present_family_index, 0, &ctx->present_queue);
+	vkGetDeviceQueue(ctx->device, best_physical_device.transfer_family_index, 0, &ctx->transfer_queue);
+	ctx->graphics_family_index = best_physical_device.graphics_family_index;
+	ctx->transfer_family_index = best_physical_device.transfer_family_index;
+
+	// Start loading textures as early as possible, so that it overlaps with the rest of
+	// initialization. Devices without BC support get cooked textures decoded on the load thread.
+	vulkan_initialize_texture_stream(ctx, device_features_2.features.textureCompressionBC != VK_TRUE);
+	for(uint32_t material_handle = 0; material_handle < MATERIAL_ASSETS_LEN; material_handle++)
+	{
+		vulkan_stream_texture(ctx, &ctx->textures[material_handle + 1], material_asset_texture_paths[material_handle]);
+	}
 
-	// Initially initialize swapchain.
-	vulkan_initialize_swapchain(ctx, false);
+	// Initially initialize swapchain. The render graph has no attachments until the first frame.
+	ctx->render_graph           = (VulkanRenderGraph){};
+	ctx->retired_swapchains_len = 0;
+	ctx->frames_submitted       = 0;
+	if(!vulkan_initialize_swapchain(ctx, false))
+	{
+		panic();
+	}
 
-	// Allocate host mapped memory buffer.
-	VkDeviceSize host_mapped_memory_size = sizeof(VulkanHostMappedData);
+	// Allocate host mapped memory buffer, with one slice per frame in flight.
+	VkDeviceSize host_mapped_memory_size = sizeof(VulkanHostMappedData) * FRAMES_IN_FLIGHT_COUNT;
 
 	vulkan_allocate_memory_buffer(
 		ctx,
 		&ctx->host_mapped_buffer,
 		host_mapped_memory_size,
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		// Small and rewritten every frame, so worth putting in the host visible window of VRAM
+		// when there is one.
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	vkMapMemory(
-		ctx->device, 
-		ctx->host_mapped_buffer.memory, 
-		0, 
-		host_mapped_memory_size, 
-		0, 
-		(void*)&ctx->host_mapped_data);
+	ctx->host_mapped_data = ctx->host_mapped_buffer.allocation.mapped;
+
+	// Allocate device local culling output buffer, with one slice per frame in flight.
+	vulkan_allocate_memory_buffer(
+		ctx,
+		&ctx->cull_memory_buffer,
+		sizeof(VulkanCullData) * FRAMES_IN_FLIGHT_COUNT,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		0);
 
-	// Create command pool and allocate main command buffer
+	// Create command pool and per frame resources.
 	VkCommandPoolCreateInfo command_pool_create_info = 
 	{
 		.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -529,7 +670,31 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 		.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
 		.commandBufferCount = 1
 	};
-	vk_verify(vkAllocateCommandBuffers(ctx->device, &command_buffer_allocate_info, &ctx->main_command_buffer));
+
+	VkSemaphoreCreateInfo semaphore_create_info =
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = 0,
+		.flags = 0
+	};
+
+	// Fences start signaled so that the first wait on each frame returns immediately.
+	VkFenceCreateInfo fence_create_info = 
+	{
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.pNext = 0,
+		.flags = VK_FENCE_CREATE_SIGNALED_BIT
+	};
+
+	for(uint8_t frame_index = 0; frame_index < FRAMES_IN_FLIGHT_COUNT; frame_index++)
+	{
+		VulkanFrame* frame = &ctx->frames[frame_index];
+
+		vk_verify(vkAllocateCommandBuffers(ctx->device, &command_buffer_allocate_info, &frame->command_buffer));
+		vk_verify(vkCreateFence(ctx->device, &fence_create_info, 0, &frame->in_flight_fence));
+		vk_verify(vkCreateSemaphore(ctx->device, &semaphore_create_info, 0, &frame->image_available_semaphore));
+	}
+	ctx->frame_index = 0;
 
 	// Create texture sampler.
 	VkSamplerCreateInfo sampler_create_info = 
@@ -549,136 +714,112 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 		.compareEnable           = VK_FALSE,
 		.compareOp               = VK_COMPARE_OP_ALWAYS,
 		.minLod                  = 0.0f,
-		.maxLod                  = 0.0f,
+		// Textures have full mip chains.
+		.maxLod                  = VK_LOD_CLAMP_NONE,
 		.borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
 		.unnormalizedCoordinates = VK_FALSE
 	};
 	vk_verify(vkCreateSampler(ctx->device, &sampler_create_info, 0, &ctx->texture_sampler));
 
-	// Allocate texture image.
-	// Load image from disk.
-	int32_t texture_w;
-	int32_t texture_h;
-	int32_t texture_channels;
-	stbi_uc* image_pixels = stbi_load("assets/viking_room.bmp", &texture_w, &texture_h, &texture_channels, STBI_rgb_alpha);
-	if(!image_pixels)
+	VkFormatProperties texture_format_properties;
+	vkGetPhysicalDeviceFormatProperties(ctx->physical_device, VK_FORMAT_R8G8B8A8_SRGB, &texture_format_properties);
+	ctx->texture_mip_filter = VK_FILTER_NEAREST;
+	if(texture_format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
 	{
-		printf("Failed to load image file.\n");
-		panic();
+		ctx->texture_mip_filter = VK_FILTER_LINEAR;
 	}
 
-	// Allocate staging buffer.
-	VulkanMemoryBuffer staging_memory_buffer;
-	VkDeviceSize staging_buffer_size = texture_w * texture_h * 4;
-
-	vulkan_allocate_memory_buffer(
-		ctx,
-		&staging_memory_buffer,
-		staging_buffer_size,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	void* mapped_buffer_data;
-	vkMapMemory(ctx->device, staging_memory_buffer.memory, 0, staging_buffer_size, 0, &mapped_buffer_data);
-	memcpy(mapped_buffer_data, image_pixels, (size_t)staging_buffer_size);
-	vkUnmapMemory(ctx->device, staging_memory_buffer.memory);
-
-	stbi_image_free(image_pixels);
+	// Upload the placeholder texture, which has to be ready before the first frame. Streamed
+	// textures are sampled through the placeholder until they are resident.
+	vulkan_initialize_transfer(ctx);
+	{
+		VulkanTexture* placeholder = &ctx->textures[VULKAN_PLACEHOLDER_TEXTURE];
+		*placeholder = (VulkanTexture){};
 
-	// Allocate image memory.
-	// TODO - Currently this assumes only one texture image.
-	vulkan_allocate_image(
-		ctx,
-		&ctx->texture_images[0],
-		(VkExtent2D){ texture_w, texture_h },
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-
-	// Transfer image from staging buffer to 
-	VkCommandBuffer transient_command_buffer = vulkan_start_transient_commands(ctx);
-	{
-		vulkan_image_memory_barrier(
-			transient_command_buffer,
-			ctx->texture_images[0].image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT);
-
-		VkBufferImageCopy region = 
-		{
-			.bufferOffset      = 0,
-			.bufferRowLength   = 0,
-			.bufferImageHeight = 0,
-			.imageSubresource  = (VkImageSubresourceLayers)
-			{ 
-				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-				.mipLevel       = 0,
-				.baseArrayLayer = 0,
-				.layerCount     = 1
-			},
-			.imageOffset       = (VkOffset3D){0, 0, 0},
-			.imageExtent       = (VkExtent3D){texture_w, texture_h, 1}
+		uint32_t placeholder_pixel = 0xffffffff;
+		VulkanTextureData placeholder_data =
+		{
+			.format         = VK_FORMAT_R8G8B8A8_SRGB,
+			.extent         = (VkExtent2D){ 1, 1 },
+			.mip_levels     = 1,
+			.levels[0]      = &placeholder_pixel,
+			.level_sizes[0] = sizeof(placeholder_pixel)
 		};
-
-		vkCmdCopyBufferToImage(
-			transient_command_buffer,
-			staging_memory_buffer.buffer,
-			ctx->texture_images[0].image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&region);
-
-		vulkan_image_memory_barrier(
-			transient_command_buffer,
-			ctx->texture_images[0].image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT);
+		if(!vulkan_record_texture_upload(ctx, placeholder, &placeholder_data))
+		{
+			panic();
+		}
+		vulkan_wait_for_transfer(ctx, vulkan_submit_transfer_batch(ctx));
+		placeholder->state = VULKAN_TEXTURE_STATE_RESIDENT;
 	}
-	vulkan_end_transient_commands(ctx, transient_command_buffer, ctx->graphics_queue);
-
-	vkDestroyBuffer(ctx->device, staging_memory_buffer.buffer, 0);
-	vkFreeMemory(ctx->device, staging_memory_buffer.memory, 0);
-
-	// Create texture image view
-	vulkan_create_image_view(
-		ctx,
-		&ctx->texture_images[0].image,
-		&ctx->texture_images[0].view,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_ASPECT_COLOR_BIT);
 
 	// Create graphics pipeline for meshes.
 	// TODO - Create second pipeline for IMGUI.
 
-	VulkanDescriptorSetConfig descriptor_set_configs[3] =
+	VulkanDescriptorSetConfig descriptor_set_configs[6] =
 	{
 		{
-			.type                  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			.shader_stage_flags    = VK_SHADER_STAGE_VERTEX_BIT,
-			.offset_in_host_memory = offsetof(VulkanHostMappedData, global),
-			.range_in_host_memory  = sizeof(VulkanHostMappedGlobal)
+			.type               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, global),
+			.range_in_buffer    = sizeof(VulkanHostMappedGlobal)
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, instance.models),
+			.range_in_buffer    = sizeof(((VulkanHostMappedInstance*)0)->models)
+		},
+		{
+			// Indexed by texture, and filled in by vulkan_bind_textures as textures become resident.
+			.type               = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.shader_stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.descriptors_len    = VULKAN_BINDLESS_TEXTURES_MAX,
+			.binding_flags      = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+			                    | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+			                    | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+			.buffer             = 0,
+			.frame_stride       = 0,
+			.offset_in_buffer   = 0,
+			.range_in_buffer    = 0
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->cull_memory_buffer.buffer,
+			.frame_stride       = sizeof(VulkanCullData),
+			.offset_in_buffer   = offsetof(VulkanCullData, visible_instances),
+			.range_in_buffer    = sizeof(((VulkanCullData*)0)->visible_instances)
 		},
 		{
-			.type                  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-			.shader_stage_flags    = VK_SHADER_STAGE_VERTEX_BIT,
-			.offset_in_host_memory = offsetof(VulkanHostMappedData, instance),
-			.range_in_host_memory  = sizeof(VulkanHostMappedInstance)
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, instance.material_indices),
+			.range_in_buffer    = sizeof(((VulkanHostMappedInstance*)0)->material_indices)
 		},
 		{
-			.type                  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.shader_stage_flags    = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.offset_in_host_memory = 0,
-			.range_in_host_memory  = 0
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, material),
+			.range_in_buffer    = sizeof(VulkanHostMappedMaterial)
 		}
 	};
 
@@ -686,301 +827,742 @@ void vulkan_initialize(VulkanContext* ctx, VulkanPlatform* platform)
 	{
 		{
 			.format                = VK_FORMAT_R32G32B32_SFLOAT,
-			.offset_in_vertex_data = offsetof(VulkanMeshVertex, position)
+			.offset_in_vertex_data = offsetof(MeshVertex, position)
 		},
 		{
 			.format                = VK_FORMAT_R32G32_SFLOAT,
-			.offset_in_vertex_data = offsetof(VulkanMeshVertex, texture_uv)
+			.offset_in_vertex_data = offsetof(MeshVertex, texture_uv)
+		},
+		{
+			.format                = VK_FORMAT_R32G32B32_SFLOAT,
+			.offset_in_vertex_data = offsetof(MeshVertex, normal)
 		}
 	};
 
-	// Create graphics pipeline.
-	// TODO - This is dependant on only having one pipeline.
+	vulkan_create_pipeline_cache(ctx);
+	vulkan_initialize_pipeline_builder(ctx);
+	ctx->shader_modules_len = 0;
+
+	VulkanPushConstantConfig draw_push_constant_config =
+	{
+		.shader_stage_flags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset             = 0,
+		.size               = sizeof(VulkanDrawPushConstants)
+	};
+
+	// Queue graphics pipeline. Until it is built, the world is drawn untextured.
+	// TODO - pipelines[PIPELINES_COUNT] only ever holds this pipeline, while the depth pre-pass,
+	// depth equal and cull pipelines are separate fields of the context. Either give every pipeline
+	// a slot in the array or replace it with a world_pipeline field.
 	vulkan_create_graphics_pipeline(
 		ctx,
 		&ctx->pipelines[0],
 		"shaders/world_vertex.spv",
 		"shaders/world_fragment.spv",
+		"shaders/placeholder_fragment.spv",
 		descriptor_set_configs,
+		6,
+		&draw_push_constant_config,
+		1,
+		vertex_input_attribute_configs,
+		3,
+		sizeof(MeshVertex),
+		VK_COMPARE_OP_LESS,
+		true);
+
+	// Queue the depth pre-pass pipelines. The pre-pass has no placeholder, so frames draw without
+	// it until it is built.
+	//
+	// VOLATILE - world_depth.vert must compute gl_Position exactly as world.vert does, or the EQUAL
+	// test will reject surfaces the pre-pass wrote.
+	VulkanDescriptorSetConfig depth_prepass_descriptor_set_configs[3] =
+	{
+		descriptor_set_configs[0],
+		descriptor_set_configs[1],
+		descriptor_set_configs[3]
+	};
+
+	vulkan_create_graphics_pipeline(
+		ctx,
+		&ctx->depth_prepass_pipeline,
+		"shaders/world_depth_vertex.spv",
+		0,
+		0,
+		depth_prepass_descriptor_set_configs,
 		3,
+		&draw_push_constant_config,
+		1,
+		&(VulkanVertexInputAttributeConfig)
+		{
+			.format                = VK_FORMAT_R32G32B32_SFLOAT,
+			.offset_in_vertex_data = 0
+		},
+		1,
+		sizeof(Vec3),
+		VK_COMPARE_OP_LESS,
+		true);
+
+	vulkan_create_graphics_pipeline(
+		ctx,
+		&ctx->depth_equal_pipeline,
+		"shaders/world_vertex.spv",
+		"shaders/world_fragment.spv",
+		"shaders/placeholder_fragment.spv",
+		descriptor_set_configs,
+		6,
+		&draw_push_constant_config,
+		1,
 		vertex_input_attribute_configs,
-		2,
-		sizeof(VulkanMeshVertex));
+		3,
+		sizeof(MeshVertex),
+		VK_COMPARE_OP_EQUAL,
+		false);
+
+	// Create compute pipeline for frustum culling.
+	VulkanDescriptorSetConfig cull_descriptor_set_configs[5] =
+	{
+		{
+			.type               = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, global),
+			.range_in_buffer    = sizeof(VulkanHostMappedGlobal)
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, instance.models),
+			.range_in_buffer    = sizeof(((VulkanHostMappedInstance*)0)->models)
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, instance.mesh_indices),
+			.range_in_buffer    = sizeof(((VulkanHostMappedInstance*)0)->mesh_indices)
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->host_mapped_buffer.buffer,
+			.frame_stride       = sizeof(VulkanHostMappedData),
+			.offset_in_buffer   = offsetof(VulkanHostMappedData, mesh.bounds),
+			.range_in_buffer    = offsetof(VulkanHostMappedMesh, first_visible_instances) + sizeof(((VulkanHostMappedMesh*)0)->first_visible_instances)
+		},
+		{
+			.type               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.shader_stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.descriptors_len    = 1,
+			.binding_flags      = 0,
+			.buffer             = ctx->cull_memory_buffer.buffer,
+			.frame_stride       = sizeof(VulkanCullData),
+			.offset_in_buffer   = 0,
+			.range_in_buffer    = sizeof(VulkanCullData)
+		}
+	};
 
-	uint8_t meshes_len = 2;
-	staging_buffer_size = 0;
-	size_t mesh_vertex_buffer_sizes[meshes_len];
-	size_t mesh_index_buffer_sizes [meshes_len];
-	VulkanMeshData mesh_datas[meshes_len];
+	vulkan_create_compute_pipeline(
+		ctx,
+		&ctx->cull_pipeline,
+		"shaders/world_cull.spv",
+		cull_descriptor_set_configs,
+		5,
+		0,
+		0);
+
+	// Register every mesh asset. Assets that resolve to a mesh that is already loaded share its
+	// vertex and index ranges, so only unique meshes are uploaded.
+	VulkanMeshData mesh_datas[MESHES_COUNT];
+	ctx->meshes_len        = 0;
+	ctx->mesh_registry_len = 0;
+	for(uint32_t asset_handle = 0; asset_handle < MESH_ASSETS_LEN; asset_handle++)
+	{
+		ctx->asset_mesh_indices[asset_handle] = vulkan_register_mesh(ctx, mesh_asset_paths[asset_handle], mesh_datas);
+	}
 
-	for(uint8_t mesh_index = 0; mesh_index < meshes_len; mesh_index++)
+	uint32_t meshes_len = ctx->meshes_len;
+	VkDeviceSize mesh_data_size = 0;
+	size_t mesh_vertex_buffer_sizes  [meshes_len];
+	size_t mesh_position_buffer_sizes[meshes_len];
+	size_t mesh_index_buffer_sizes   [meshes_len];
+
+	for(uint32_t mesh_index = 0; mesh_index < meshes_len; mesh_index++)
 	{
 		VulkanMeshData* data = &mesh_datas[mesh_index];
-		vulkan_load_mesh(data, "assets/viking_room.obj");
 
 		VulkanAllocatedMesh* mesh = &ctx->allocated_meshes[mesh_index];
-		mesh->vertices_len = data->vertices_len;
-		mesh->indices_len  = data->indices_len;
+		mesh->vertices_len  = data->vertices_len;
+		mesh->indices_len   = data->indices_len;
+		mesh->index_type    = data->index_type;
+		mesh->bounds_center = data->bounds_center;
+		mesh->bounds_radius = data->bounds_radius;
+
+		mesh_vertex_buffer_sizes[mesh_index]   = MESH_VERTEX_STRIDE * mesh->vertices_len;
+		mesh_position_buffer_sizes[mesh_index] = sizeof(Vec3)       * mesh->vertices_len;
+		mesh_index_buffer_sizes[mesh_index]    = data->index_size   * mesh->indices_len;
+
+		mesh->vertex_buffer_offset   = mesh_data_size;
+		mesh->position_buffer_offset = mesh->vertex_buffer_offset + mesh_vertex_buffer_sizes[mesh_index];
+		mesh->index_buffer_offset    = mesh->position_buffer_offset + mesh_position_buffer_sizes[mesh_index];
+		
+		// 16 bit index buffers can end off of a 4 byte boundary, so realign for the next mesh.
+		mesh_data_size = vulkan_align_up(mesh->index_buffer_offset + mesh_index_buffer_sizes[mesh_index], 4);
+	}
 
-		mesh_vertex_buffer_sizes[mesh_index] = MESH_VERTEX_STRIDE * mesh->vertices_len;
-		mesh_index_buffer_sizes[mesh_index]  = sizeof(uint32_t)   * mesh->indices_len;
+	// With ReBAR or UMA, the mesh buffer is written directly. Otherwise the data goes through the
+	// staging ring and is copied over on the transfer queue, with every mesh in one batch.
+	bool direct_mesh_upload = ctx->memory_allocator.device_local_host_visible;
 
-		mesh->vertex_buffer_offset = staging_buffer_size;
-		mesh->index_buffer_offset = staging_buffer_size + mesh_vertex_buffer_sizes[mesh_index];
-		
-		staging_buffer_size += mesh_vertex_buffer_sizes[mesh_index] + mesh_index_buffer_sizes[mesh_index];
+	VkMemoryPropertyFlags mesh_memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if(direct_mesh_upload)
+	{
+		mesh_memory_properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 	}
 
 	vulkan_allocate_memory_buffer(
 		ctx,
-		&staging_memory_buffer,
-		staging_buffer_size, 
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		&ctx->mesh_data_memory_buffer,
+		mesh_data_size, 
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		mesh_memory_properties,
+		0);
 
-	vkMapMemory(ctx->device, staging_memory_buffer.memory, 0, staging_buffer_size, 0, &mapped_buffer_data);
+	for(uint32_t mesh_index = 0; mesh_index < meshes_len; mesh_index++)
 	{
-		size_t total_offset = 0;
-		for(uint8_t mesh_index = 0; mesh_index < meshes_len; mesh_index++)
+		VulkanAllocatedMesh* mesh = &ctx->allocated_meshes[mesh_index];
+		VulkanMeshData*      data = &mesh_datas[mesh_index];
+
+		// The depth pre-pass reads positions alone, so that it fetches a third of the vertex data.
+		Vec3* positions = malloc(mesh_position_buffer_sizes[mesh_index]);
+		if(positions == 0)
 		{
-			VulkanAllocatedMesh* mesh = &ctx->allocated_meshes[mesh_index];
-			VulkanMeshData*      data = &mesh_datas[mesh_index];
+			panic();
+		}
+		for(uint32_t vertex_index = 0; vertex_index < mesh->vertices_len; vertex_index++)
+		{
+			positions[vertex_index] = data->vertices[vertex_index].position;
+		}
 
-			memcpy(mapped_buffer_data + mesh->vertex_buffer_offset, data->vertices, mesh_vertex_buffer_sizes[mesh_index]);
-			memcpy(mapped_buffer_data + mesh->index_buffer_offset,  data->indices,  mesh_index_buffer_sizes[mesh_index]);
-			total_offset += mesh_vertex_buffer_sizes[mesh_index] + mesh_index_buffer_sizes[mesh_index];
+		if(direct_mesh_upload)
+		{
+			void* mapped_buffer_data = ctx->mesh_data_memory_buffer.allocation.mapped;
+			memcpy(mapped_buffer_data + mesh->vertex_buffer_offset,   data->vertices, mesh_vertex_buffer_sizes[mesh_index]);
+			memcpy(mapped_buffer_data + mesh->position_buffer_offset, positions,      mesh_position_buffer_sizes[mesh_index]);
+			memcpy(mapped_buffer_data + mesh->index_buffer_offset,    data->indices,  mesh_index_buffer_sizes[mesh_index]);
+		}
+		else
+		{
+			// If the ring fills up, make room by waiting for the uploads which are already in it.
+			VkBuffer mesh_buffer = ctx->mesh_data_memory_buffer.buffer;
+			while(!vulkan_upload_buffer(ctx, mesh_buffer, mesh->vertex_buffer_offset, data->vertices, mesh_vertex_buffer_sizes[mesh_index]))
+			{
+				vulkan_wait_for_transfer(ctx, vulkan_submit_transfer_batch(ctx));
+			}
+			while(!vulkan_upload_buffer(ctx, mesh_buffer, mesh->position_buffer_offset, positions, mesh_position_buffer_sizes[mesh_index]))
+			{
+				vulkan_wait_for_transfer(ctx, vulkan_submit_transfer_batch(ctx));
+			}
+			while(!vulkan_upload_buffer(ctx, mesh_buffer, mesh->index_buffer_offset, data->indices, mesh_index_buffer_sizes[mesh_index]))
+			{
+				vulkan_wait_for_transfer(ctx, vulkan_submit_transfer_batch(ctx));
+			}
 		}
+
+		free(positions);
+		vulkan_free_mesh_data(data);
 	}
-	vkUnmapMemory(ctx->device, staging_memory_buffer.memory);
 
-	vulkan_allocate_memory_buffer(
-		ctx,
-		&ctx->mesh_data_memory_buffer,
-		staging_buffer_size, 
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	// The first frame acquires the mesh buffer and waits for the upload on the GPU, so nothing here
+	// waits for it to finish.
+	if(!direct_mesh_upload)
+	{
+		vulkan_release_buffer(
+			ctx,
+			ctx->mesh_data_memory_buffer.buffer,
+			0,
+			VK_WHOLE_SIZE,
+			VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+			VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT);
+		vulkan_submit_transfer_batch(ctx);
+	}
+
+#if VK_DEBUG
+	vulkan_print_memory_stats(ctx);
+#endif
+}
+
+// One indirect instanced draw per mesh, with instance counts decided by the culling shader. The
+// vertex shader finds each instance's model matrix through the visible instance list, at the draw's
+// first visible instance plus gl_InstanceIndex. Nothing is rebound per draw but the mesh buffers.
+//
+// Depth only draws read the meshes' position streams rather than their full vertices.
+void vulkan_record_world_draws(
+	VulkanContext*   ctx,
+	VkCommandBuffer  command_buffer,
+	VulkanPipeline*  pipeline,
+	bool             positions_only,
+	VkDeviceSize     cull_data_offset,
+	uint32_t*        mesh_first_visible_instances)
+{
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_pipeline_for_draw(ctx, pipeline));
+
+	vkCmdBindDescriptorSets(
+		command_buffer, 
+		VK_PIPELINE_BIND_POINT_GRAPHICS, 
+		pipeline->layout, 
+		0, 
+		1, 
+		&pipeline->descriptor_sets[ctx->frame_index],
+		0,
+		0);
 
-	transient_command_buffer = vulkan_start_transient_commands(ctx);
+	for(uint32_t mesh_index = 0; mesh_index < ctx->meshes_len; mesh_index++)
 	{
-		VkBufferCopy buffer_copy = {};
-		buffer_copy.size = staging_buffer_size;
-		vkCmdCopyBuffer(transient_command_buffer, staging_memory_buffer.buffer, ctx->mesh_data_memory_buffer.buffer, 1, &buffer_copy);
+		VulkanAllocatedMesh* mesh = &ctx->allocated_meshes[mesh_index];
+
+		VulkanDrawPushConstants push_constants =
+		{
+			.first_visible_instance = mesh_first_visible_instances[mesh_index]
+		};
+		vkCmdPushConstants(
+			command_buffer,
+			pipeline->layout,
+			VK_SHADER_STAGE_VERTEX_BIT,
+			0,
+			sizeof(push_constants),
+			&push_constants);
+
+		VkDeviceSize offsets[] = {positions_only ? mesh->position_buffer_offset : mesh->vertex_buffer_offset};
+		vkCmdBindVertexBuffers(
+			command_buffer, 
+			0, 
+			1, 
+			&ctx->mesh_data_memory_buffer.buffer,
+			offsets);
+
+		vkCmdBindIndexBuffer(
+			command_buffer, 
+			ctx->mesh_data_memory_buffer.buffer, 
+			mesh->index_buffer_offset, 
+			mesh->index_type);
+
+		vkCmdDrawIndexedIndirect(
+			command_buffer, 
+			ctx->cull_memory_buffer.buffer, 
+			cull_data_offset + offsetof(VulkanCullData, draw_commands) + mesh_index * sizeof(VkDrawIndexedIndirectCommand), 
+			1, 
+			sizeof(VkDrawIndexedIndirectCommand));
 	}
-	vulkan_end_transient_commands(ctx, transient_command_buffer, ctx->graphics_queue);
+}
+
+// Resets the draw commands from the host mapped templates, for culling to append to.
+void vulkan_record_reset_draw_commands_pass(VkCommandBuffer command_buffer, void* data)
+{
+	VulkanFramePassData* pass_data = data;
+	VulkanContext*       ctx       = pass_data->ctx;
+
+	VkBufferCopy draw_commands_copy = 
+	{
+		.srcOffset = ctx->frame_index * sizeof(VulkanHostMappedData) + offsetof(VulkanHostMappedData, mesh.draw_commands),
+		.dstOffset = pass_data->cull_data_offset + offsetof(VulkanCullData, draw_commands),
+		.size      = MESHES_COUNT * sizeof(VkDrawIndexedIndirectCommand)
+	};
+	vkCmdCopyBuffer(command_buffer, ctx->host_mapped_buffer.buffer, ctx->cull_memory_buffer.buffer, 1, &draw_commands_copy);
+}
 
-	vkDestroyBuffer(ctx->device, staging_memory_buffer.buffer, 0);
-	vkFreeMemory(ctx->device, staging_memory_buffer.memory, 0);
+// Culls instances against the view frustum. The compute shader appends every visible instance to
+// its mesh's draw command and the visible instance list.
+void vulkan_record_cull_pass(VkCommandBuffer command_buffer, void* data)
+{
+	VulkanFramePassData* pass_data = data;
+	VulkanContext*       ctx       = pass_data->ctx;
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_wait_for_pipeline(ctx, &ctx->cull_pipeline));
+	vkCmdBindDescriptorSets(
+		command_buffer, 
+		VK_PIPELINE_BIND_POINT_COMPUTE, 
+		ctx->cull_pipeline.layout, 
+		0, 
+		1, 
+		&ctx->cull_pipeline.descriptor_sets[ctx->frame_index],
+		0,
+		0);
+	vkCmdDispatch(command_buffer, (pass_data->render_list->static_meshes_len + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
 }
 
-void vulkan_loop(VulkanContext* ctx, RenderList* render_list)
+// Draws the world into the multisampled color attachment, resolving into the swapchain image, or
+// into the swapchain image directly with MSAA off. The multisampled attachments are only stored if
+// a later pass uses them, so as it stands only the resolve ever leaves tile memory.
+void vulkan_record_world_pass(VkCommandBuffer command_buffer, void* data)
 {
-	// Translate game memory to uniform buffer object memory.
-	VulkanHostMappedData mem = {};
+	VulkanFramePassData* pass_data   = data;
+	VulkanContext*       ctx         = pass_data->ctx;
+	RenderList*          render_list = pass_data->render_list;
+	bool                 resolve     = pass_data->color_resource != pass_data->swapchain_resource;
+
+	VkRenderingInfo render_info = 
 	{
-		mem.global.clear_color = render_list->clear_color;
+		.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		.renderArea           = (VkRect2D){{0, 0}, ctx->swapchain_extent},
+		.layerCount           = 1,
+		.colorAttachmentCount = 1,
+		.pColorAttachments    = &(VkRenderingAttachmentInfo)
+		{
+			.sType                   = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+			.pNext                   = 0,
+			.imageView               = vulkan_render_graph_image_view(pass_data->graph, pass_data->color_resource),
+			.imageLayout             = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			.resolveMode             = resolve ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE,
+			.resolveImageView        = resolve ? vulkan_render_graph_image_view(pass_data->graph, pass_data->swapchain_resource) : 0,
+			.resolveImageLayout      = resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+			.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			.storeOp                 = vulkan_render_graph_store_op(pass_data->graph, pass_data->color_resource),
+			.clearValue.color        = (VkClearColorValue)
+			{{
+				render_list->clear_color.r, 
+				render_list->clear_color.g, 
+				render_list->clear_color.b, 
+				1.0f
+			}},
+		},
+		.pDepthAttachment     = &(VkRenderingAttachmentInfo)
+		{
+			.sType                   = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+			.pNext                   = 0,
+			.imageView               = vulkan_render_graph_image_view(pass_data->graph, pass_data->depth_resource),
+			.imageLayout             = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			.resolveMode             = VK_RESOLVE_MODE_NONE,
+			.resolveImageView        = 0,
+			.resolveImageLayout      = 0,
+			.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			.storeOp                 = vulkan_render_graph_store_op(pass_data->graph, pass_data->depth_resource),
+			.clearValue.depthStencil = (VkClearDepthStencilValue)
+			{
+				1.0f,
+				0
+			}
+		},
+		.pStencilAttachment   = 0
+	};
 
-		glm_lookat(render_list->camera_position.data, render_list->camera_target.data, vec3_new(0, 1, 0).data, mem.global.view);
-		glm_perspective(radians(75), (float)ctx->swapchain_extent.width / (float)ctx->swapchain_extent.height, 0.1, 100, mem.global.projection);
-		mem.global.projection[1][1] *= -1;
+	vkCmdBeginRendering(command_buffer, &render_info);
+	{
+		VkViewport viewport = 
+		{
+			.x        = 0,
+			.y        = 0,
+			.width    = (float)ctx->swapchain_extent.width,
+			.height   = (float)ctx->swapchain_extent.height,
+			.minDepth = 0,
+			.maxDepth = 1
+		};
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
 
-		mat4 mesh_transforms[render_list->static_meshes_len];
-		for(uint8_t mesh_index = 0; mesh_index < render_list->static_meshes_len; mesh_index++)
+		VkRect2D scissor = 
 		{
-		 	mat4* transform  = &mesh_transforms[mesh_index];
-		 	StaticMesh* mesh = &render_list->static_meshes[mesh_index];
+			.offset = (VkOffset2D){0, 0},
+			.extent = ctx->swapchain_extent
+		};
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-		    glm_mat4_identity(*transform);
-		    glm_translate(*transform, mesh->position.data);
-		    glm_mat4_mul(*transform, mesh->orientation, *transform);
+		// Render world. With the depth pre-pass on, the world is drawn twice: once depth only, and
+		// once shaded with an EQUAL test. The pre-pass is skipped until its pipeline is built.
+		bool depth_prepass = render_list->depth_prepass && vulkan_pipeline_built(ctx, &ctx->depth_prepass_pipeline);
+		if(depth_prepass != ctx->depth_prepass)
+		{
+			printf("Depth pre-pass: %s\n", depth_prepass ? "on" : "off");
+			ctx->depth_prepass = depth_prepass;
 		}
-		memcpy(mem.instance.models, mesh_transforms, sizeof(mem.instance.models));
+		if(depth_prepass)
+		{
+			vulkan_record_world_draws(
+				ctx,
+				command_buffer,
+				&ctx->depth_prepass_pipeline,
+				true,
+				pass_data->cull_data_offset,
+				pass_data->mesh_first_visible_instances);
+		}
+
+		vulkan_record_world_draws(
+			ctx,
+			command_buffer,
+			depth_prepass ? &ctx->depth_equal_pipeline : &ctx->pipelines[0],
+			false,
+			pass_data->cull_data_offset,
+			pass_data->mesh_first_visible_instances);
+	}
+	vkCmdEndRendering(command_buffer);
+}
+
+// Returns false if the swapchain needed recreating but the surface has no area, as when the window
+// is minimized. Nothing will be rendered until the surface changes, so the caller should wait for
+// that rather than call this again straight away.
+bool vulkan_loop(VulkanContext* ctx, RenderList* render_list)
+{
+	VulkanFrame* frame = &ctx->frames[ctx->frame_index];
+
+	// Wait for the GPU to finish with the last submission which used this frame's resources. The
+	// other frames in flight may still be rendering while we record this one.
+	vk_verify(vkWaitForFences(ctx->device, 1, &frame->in_flight_fence, VK_TRUE, UINT64_MAX));
+	vulkan_destroy_retired_swapchains(ctx);
+
+	VkSampleCountFlagBits msaa_samples = vulkan_msaa_tier_samples(ctx, render_list->msaa_tier);
+	if(msaa_samples != ctx->msaa_samples)
+	{
+		vulkan_set_msaa_samples(ctx, msaa_samples);
 	}
-	memcpy(ctx->host_mapped_data, &mem, sizeof(mem));
+
+	// Record uploads for any textures the load thread has finished with, then submit everything
+	// uploaded this frame in a single batch. This never waits on the transfer queue.
+	vulkan_update_pipeline_builder(ctx);
+	vulkan_update_texture_stream(ctx);
+	vulkan_submit_transfer_batch(ctx);
 
 	uint32_t image_index;
 	VkResult res = vkAcquireNextImageKHR(
 		ctx->device, 
 		ctx->swapchain, 
 		UINT64_MAX, 
-		ctx->image_available_semaphore, 
+		frame->image_available_semaphore, 
 		0, 
 		&image_index);
-	if(res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
+	// A suboptimal swapchain still hands us an image and signals the semaphore, so we render this
+	// frame as normal and recreate the swapchain after presenting.
+	if(res == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		return vulkan_initialize_swapchain(ctx, true);
+	}
+
+	// Only reset the fence once we know we will be submitting work which signals it.
+	vk_verify(vkResetFences(ctx->device, 1, &frame->in_flight_fence));
+
+	// Translate game memory to this frame's slice of host mapped memory.
+	//
+	// Instances are bucketed by asset handle as they are written, so that every instance of a given
+	// mesh ends up contiguous and can be drawn with a single instanced draw call. Which of those
+	// instances are actually drawn is decided on the GPU by the culling compute shader.
+	VulkanHostMappedData* mem = (VulkanHostMappedData*)ctx->host_mapped_data + ctx->frame_index;
+
+	// Kept on the CPU as well, for the draw push constants, rather than read back from host mapped
+	// memory.
+	uint32_t mesh_first_visible_instances[MESHES_COUNT];
 	{
-		vulkan_initialize_swapchain(ctx, true);
-		return;
+		mem->global.clear_color = render_list->clear_color;
+
+		glm_lookat(render_list->camera_position.data, render_list->camera_target.data, vec3_new(0, 1, 0).data, mem->global.view);
+		glm_perspective(radians(75), (float)ctx->swapchain_extent.width / (float)ctx->swapchain_extent.height, 0.1, 100, mem->global.projection);
+		mem->global.projection[1][1] *= -1;
+
+		glm_mat4_mul(mem->global.projection, mem->global.view, mem->global.view_projection);
+		mem->global.instances_len = render_list->static_meshes_len;
+
+		// Materials sample the placeholder until their texture is bound.
+		for(uint32_t material_handle = 0; material_handle < MATERIAL_ASSETS_LEN; material_handle++)
+		{
+			mem->material.texture_indices[material_handle] = vulkan_resident_texture_index(ctx, material_handle + 1);
+		}
+
+		// Instances are bucketed by the unique mesh their asset resolves to, so assets that share a
+		// mesh are drawn together.
+		uint32_t mesh_instance_counts[MESHES_COUNT] = {};
+		for(uint32_t static_mesh_index = 0; static_mesh_index < render_list->static_meshes_len; static_mesh_index++)
+		{
+			mesh_instance_counts[ctx->asset_mesh_indices[render_list->static_meshes[static_mesh_index].asset_handle]]++;
+		}
+
+		// Each mesh's draw command starts out with no instances, and its visible instances start at
+		// the start of its bucket. The culling shader appends surviving instances from there.
+		uint32_t mesh_instance_cursors[MESHES_COUNT];
+		uint32_t first_instance = 0;
+		for(uint32_t mesh_index = 0; mesh_index < ctx->meshes_len; mesh_index++)
+		{
+			VulkanAllocatedMesh* mesh = &ctx->allocated_meshes[mesh_index];
+
+			mem->mesh.bounds[mesh_index] = (Vec4){{{
+				mesh->bounds_center.x, 
+				mesh->bounds_center.y, 
+				mesh->bounds_center.z, 
+				mesh->bounds_radius
+			}}};
+
+			mem->mesh.draw_commands[mesh_index] = (VkDrawIndexedIndirectCommand)
+			{
+				.indexCount    = mesh->indices_len,
+				.instanceCount = 0,
+				.firstIndex    = 0,
+				.vertexOffset  = 0,
+				.firstInstance = 0
+			};
+			mem->mesh.first_visible_instances[mesh_index] = first_instance;
+			mesh_first_visible_instances[mesh_index]      = first_instance;
+
+			mesh_instance_cursors[mesh_index] = first_instance;
+			first_instance += mesh_instance_counts[mesh_index];
+		}
+
+		for(uint32_t static_mesh_index = 0; static_mesh_index < render_list->static_meshes_len; static_mesh_index++)
+		{
+		 	StaticMesh* static_mesh = &render_list->static_meshes[static_mesh_index];
+		 	uint32_t    mesh_index  = ctx->asset_mesh_indices[static_mesh->asset_handle];
+		 	mat4        transform;
+
+		    glm_mat4_identity(transform);
+		    glm_translate(transform, static_mesh->position.data);
+		    glm_mat4_mul(transform, static_mesh->orientation, transform);
+
+			uint32_t instance_index = mesh_instance_cursors[mesh_index]++;
+			glm_mat4_copy(transform, mem->instance.models[instance_index]);
+			mem->instance.mesh_indices[instance_index]     = mesh_index;
+			mem->instance.material_indices[instance_index] = static_mesh->material_handle;
+		}
 	}
 
+	VkDeviceSize cull_data_offset = ctx->frame_index * sizeof(VulkanCullData);
+
+	VkCommandBuffer command_buffer = frame->command_buffer;
+
 	VkCommandBufferBeginInfo command_buffer_begin_info = 
 	{
 		.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.pNext            = 0,
-		.flags            = 0,
+		.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 		.pInheritanceInfo = 0
 	};
 
-	vkBeginCommandBuffer(ctx->main_command_buffer, &command_buffer_begin_info);
+	uint64_t transfer_wait_value;
+
+	vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
 	{
-		// Render image transfer
-		vulkan_image_memory_barrier(
-			ctx->main_command_buffer, 
-			ctx->swapchain_images[image_index], 
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			0,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		// Depth image transfer
-		vulkan_image_memory_barrier(
-			ctx->main_command_buffer, 
-			ctx->depth_image.image, 
-			VK_IMAGE_ASPECT_DEPTH_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-			0,
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+		// Take ownership of buffers and textures uploaded on the transfer queue, all with one
+		// barrier, then write the textures into the world pipeline's texture array. Materials sample
+		// them from the next frame on, once this frame's acquire barriers are ordered before the
+		// draws that use them.
+		VulkanBarrierBatch acquire_barriers;
+		vulkan_begin_barrier_batch(&acquire_barriers, command_buffer);
 
-		VkRenderingInfo render_info = 
-		{
-			.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO,
-			.renderArea           = (VkRect2D){{0, 0}, ctx->swapchain_extent},
-			.layerCount           = 1,
-			.colorAttachmentCount = 1,
-			.pColorAttachments    = &(VkRenderingAttachmentInfo)
-			{
-				.sType                   = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-				.pNext                   = 0,
-				.imageView               = ctx->render_image.view,
-				.imageLayout             = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-				.resolveMode             = VK_RESOLVE_MODE_AVERAGE_BIT,
-				.resolveImageView        = ctx->swapchain_image_views[image_index],
-				.resolveImageLayout      = VK_IMAGE_LAYOUT_GENERAL,
-				.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE,
-				.clearValue.color        = (VkClearColorValue)
-				{{
-					render_list->clear_color.r, 
-					render_list->clear_color.g, 
-					render_list->clear_color.b, 
-					1.0f
-				}},
-			},
-			.pDepthAttachment     = &(VkRenderingAttachmentInfo)
-			{
-				.sType                   = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-				.pNext                   = 0,
-				.imageView               = ctx->depth_image.view,
-				.imageLayout             = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-				.resolveMode             = VK_RESOLVE_MODE_NONE,
-				.resolveImageView        = 0,
-				.resolveImageLayout      = 0,
-				.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR,
-				.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE,
-				.clearValue.depthStencil = (VkClearDepthStencilValue)
-				{
-					1.0f,
-					0
-				}
-			},
-			.pStencilAttachment   = 0
-		};
+		transfer_wait_value = vulkan_record_buffer_acquires(ctx, &acquire_barriers);
 
-		vkCmdBeginRendering(ctx->main_command_buffer, &render_info);
+		uint64_t texture_wait_value = vulkan_record_texture_acquires(ctx, &acquire_barriers);
+		if(texture_wait_value > transfer_wait_value)
 		{
-			VkViewport viewport = 
-			{
-				.x        = 0,
-				.y        = 0,
-				.width    = (float)ctx->swapchain_extent.width,
-				.height   = (float)ctx->swapchain_extent.height,
-				.minDepth = 0,
-				.maxDepth = 1
-			};
-			vkCmdSetViewport(ctx->main_command_buffer, 0, 1, &viewport);
-
-			VkRect2D scissor = 
-			{
-				.offset = (VkOffset2D){0, 0},
-				.extent = ctx->swapchain_extent
-			};
-			vkCmdSetScissor(ctx->main_command_buffer, 0, 1, &scissor);
-
-			// Render world
-			// TODO - This only involves one pipeline, of course.
-			vkCmdBindPipeline(ctx->main_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipelines[0].pipeline);
-
-			VkDeviceSize offsets[] = {ctx->allocated_meshes[0].vertex_buffer_offset};
-			vkCmdBindVertexBuffers(
-				ctx->main_command_buffer, 
-				0, 
-				1, 
-				&ctx->mesh_data_memory_buffer.buffer,
-				offsets);
-
-			vkCmdBindIndexBuffer(
-				ctx->main_command_buffer, 
-				ctx->mesh_data_memory_buffer.buffer, 
-				ctx->allocated_meshes[0].index_buffer_offset, 
-				VK_INDEX_TYPE_UINT32);
-
-			for(uint16_t instance = 0; instance < STATIC_MESHES_LEN; instance++) 
-			{
-				uint32_t dynamic_offset = instance * sizeof(mat4);
-
-				vkCmdBindDescriptorSets(
-					ctx->main_command_buffer, 
-					VK_PIPELINE_BIND_POINT_GRAPHICS, 
-					ctx->pipelines[0].layout, 
-					0, 
-					1, 
-					&ctx->pipelines[0].descriptor_set,
-					1,
-					&dynamic_offset);
-				vkCmdDrawIndexed(ctx->main_command_buffer, ctx->allocated_meshes[0].indices_len, 1, 0, 0, 0);
-			}
+			transfer_wait_value = texture_wait_value;
 		}
-		vkCmdEndRendering(ctx->main_command_buffer);
-
-		vulkan_image_memory_barrier(
-			ctx->main_command_buffer, 
-			ctx->swapchain_images[image_index], 
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			0,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		vulkan_flush_barrier_batch(&acquire_barriers);
+
+		VulkanPipeline* textured_pipelines[2] = { &ctx->pipelines[0], &ctx->depth_equal_pipeline };
+		vulkan_bind_textures(ctx, textured_pipelines, 2, 2);
+
+		// The frame's passes. The attachments are transients of the render graph, and the swapchain
+		// image it resolves into is imported so that it is left ready to present. Without MSAA, the
+		// world is drawn straight into the swapchain image.
+		VulkanRenderGraph* graph = &ctx->render_graph;
+		vulkan_begin_render_graph(graph, ctx->swapchain_extent);
+
+		// The image is only available once the acquire semaphore, waited on at color attachment
+		// output, has been signaled.
+		VulkanFramePassData pass_data =
+		{
+			.ctx                          = ctx,
+			.render_list                  = render_list,
+			.graph                        = graph,
+			.cull_data_offset             = cull_data_offset,
+			.mesh_first_visible_instances = mesh_first_visible_instances,
+			.image_index                  = image_index,
+			.swapchain_resource           = vulkan_render_graph_import_image(
+				graph,
+				ctx->swapchain_images[image_index],
+				ctx->swapchain_image_views[image_index],
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				(VulkanResourceState){ .write_stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, .layout = VK_IMAGE_LAYOUT_UNDEFINED },
+				VULKAN_RESOURCE_USAGE_PRESENT_BIT),
+			.depth_resource               = vulkan_render_graph_create_image(
+				graph,
+				VK_FORMAT_D32_SFLOAT,
+				ctx->msaa_samples,
+				VK_IMAGE_ASPECT_DEPTH_BIT)
+		};
+		pass_data.color_resource = ctx->msaa_samples == VK_SAMPLE_COUNT_1_BIT
+			? pass_data.swapchain_resource
+			: vulkan_render_graph_create_image(graph, ctx->surface_format.format, ctx->msaa_samples, VK_IMAGE_ASPECT_COLOR_BIT);
+		uint32_t cull_resource = vulkan_render_graph_import_buffer(
+			graph,
+			ctx->cull_memory_buffer.buffer,
+			cull_data_offset,
+			sizeof(VulkanCullData));
+
+		uint32_t reset_pass = vulkan_render_graph_add_pass(graph, "reset draw commands", vulkan_record_reset_draw_commands_pass, &pass_data);
+		vulkan_render_graph_use(graph, reset_pass, cull_resource, VULKAN_RESOURCE_USAGE_TRANSFER_WRITE_BIT);
+
+		uint32_t cull_pass = vulkan_render_graph_add_pass(graph, "cull", vulkan_record_cull_pass, &pass_data);
+		vulkan_render_graph_use(graph, cull_pass, cull_resource, VULKAN_RESOURCE_USAGE_COMPUTE_READ_BIT | VULKAN_RESOURCE_USAGE_COMPUTE_WRITE_BIT);
+
+		uint32_t world_pass = vulkan_render_graph_add_pass(graph, "world", vulkan_record_world_pass, &pass_data);
+		vulkan_render_graph_use(graph, world_pass, cull_resource, VULKAN_RESOURCE_USAGE_INDIRECT_READ_BIT | VULKAN_RESOURCE_USAGE_VERTEX_SHADER_READ_BIT);
+		vulkan_render_graph_use(graph, world_pass, pass_data.color_resource, VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT);
+		vulkan_render_graph_use(graph, world_pass, pass_data.depth_resource, VULKAN_RESOURCE_USAGE_DEPTH_ATTACHMENT_BIT);
+		vulkan_render_graph_use(graph, world_pass, pass_data.swapchain_resource, VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT);
+
+		vulkan_execute_render_graph(ctx, graph, command_buffer);
 	}
-	vkEndCommandBuffer(ctx->main_command_buffer);
+	vkEndCommandBuffer(command_buffer);
 
 	// We wait to submit until that images is available from before. We did all
 	// this prior stuff in the meantime, in theory.
+	//
+	// If textures were acquired from the transfer queue, the submission also waits on the transfer
+	// timeline to complete the ownership transfer. The host has already seen it reach that value, so
+	// this doesn't hold anything up.
+	uint32_t             wait_semaphores_len = transfer_wait_value > 0 ? 2 : 1;
+	VkSemaphore          wait_semaphores[2]  = { frame->image_available_semaphore, ctx->transfer_timeline };
+	uint64_t             wait_values[2]      = { 0, transfer_wait_value };
+	VkPipelineStageFlags wait_stage_masks[2] = 
+	{
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+	};
+
 	VkSubmitInfo submit_info = 
 	{
 		.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.pNext                = 0,
-		.waitSemaphoreCount   = 1,
-		.pWaitSemaphores      = &ctx->image_available_semaphore,
-		.pWaitDstStageMask    = &(VkPipelineStageFlags){ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT },
+		.pNext                = &(VkTimelineSemaphoreSubmitInfo)
+		{
+			.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.pNext                     = 0,
+			.waitSemaphoreValueCount   = wait_semaphores_len,
+			.pWaitSemaphoreValues      = wait_values,
+			.signalSemaphoreValueCount = 0,
+			.pSignalSemaphoreValues    = 0
+		},
+		.waitSemaphoreCount   = wait_semaphores_len,
+		.pWaitSemaphores      = wait_semaphores,
+		.pWaitDstStageMask    = wait_stage_masks,
 		.commandBufferCount   = 1,
-		.pCommandBuffers      = &ctx->main_command_buffer,
+		.pCommandBuffers      = &command_buffer,
 		.signalSemaphoreCount = 1,
-		.pSignalSemaphores    = &ctx->render_finished_semaphore
+		.pSignalSemaphores    = &ctx->swapchain_render_finished_semaphores[image_index]
 	};
-	vkQueueSubmit(ctx->graphics_queue, 1, &submit_info, 0);
+	vk_verify(vkQueueSubmit(ctx->graphics_queue, 1, &submit_info, frame->in_flight_fence));
+	ctx->frames_submitted++;
 
 	VkPresentInfoKHR present_info = 
 	{
 		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 		.pNext              = 0,
 		.waitSemaphoreCount = 1,
-		.pWaitSemaphores    = &ctx->render_finished_semaphore,
+		.pWaitSemaphores    = &ctx->swapchain_render_finished_semaphores[image_index],
 		.swapchainCount     = 1,
 		.pSwapchains        = &ctx->swapchain,
 		.pImageIndices      = &image_index,
@@ -988,11 +1570,12 @@ void vulkan_loop(VulkanContext* ctx, RenderList* render_list)
 	};
 
 	res = vkQueuePresentKHR(ctx->present_queue, &present_info); 
+	bool surface_has_area = true;
 	if(res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
 	{
-		vulkan_initialize_swapchain(ctx, true);
-		return;
+		surface_has_area = vulkan_initialize_swapchain(ctx, true);
 	}
 
-	vkDeviceWaitIdle(ctx->device);
+	ctx->frame_index = (ctx->frame_index + 1) % FRAMES_IN_FLIGHT_COUNT;
+	return surface_has_area;
 }
@@ -1,45 +1,408 @@
-void vulkan_allocate_memory(
-	VulkanContext*       ctx, 
-	VkDeviceMemory*      memory,
-	VkMemoryRequirements requirements,
-	uint32_t             type_mask)
+// Device memory is handed out by a block allocator. Each block is a single vkAllocateMemory call
+// of a single memory type, and resources are sub-allocated from it, first from holes left by freed
+// resources (first fit) and otherwise from the block's linear head.
+//
+// Buffers and linear images must not share a bufferImageGranularity sized page with optimally
+// tiled images. When the device reports a granularity above 1, the two kinds of resources are kept
+// in separate blocks so that they never neighbour one another.
+
+VkDeviceSize vulkan_align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void vulkan_initialize_memory_allocator(VulkanContext* ctx)
 {
-	VkPhysicalDeviceMemoryProperties properties;
-	vkGetPhysicalDeviceMemoryProperties(ctx->physical_device, &properties);
+	VulkanMemoryAllocator* allocator = &ctx->memory_allocator;
+	*allocator = (VulkanMemoryAllocator){};
+
+	vkGetPhysicalDeviceMemoryProperties(ctx->physical_device, &allocator->memory_properties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(ctx->physical_device, &properties);
+	allocator->buffer_image_granularity = properties.limits.bufferImageGranularity;
 
-	uint32_t suitable_type_index = UINT32_MAX;
-	for(uint32_t type_index = 0; type_index < properties.memoryTypeCount; type_index++)
+	// Detect whether the CPU can write straight into a meaningful amount of device local memory.
+	// This is the case with resizable BAR, where the whole of VRAM is host visible, and on UMA
+	// devices, where all memory is both. Without ReBAR, the host visible window into VRAM is
+	// typically 256MB and is better left to small, frequently written data.
+	VkPhysicalDeviceMemoryProperties* memory_properties = &allocator->memory_properties;
+	VkMemoryPropertyFlags direct_flags = 
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	VkDeviceSize largest_device_local_heap_size = 0;
+	for(uint32_t heap_index = 0; heap_index < memory_properties->memoryHeapCount; heap_index++)
 	{
-		if((requirements.memoryTypeBits & (1 << type_index))
-			&& (properties.memoryTypes[type_index].propertyFlags & type_mask) == type_mask)
+		VkMemoryHeap* heap = &memory_properties->memoryHeaps[heap_index];
+		if(heap->flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT && heap->size > largest_device_local_heap_size)
 		{
-			suitable_type_index = type_index;
-			break;
+			largest_device_local_heap_size = heap->size;
 		}
-	}	
-	if(suitable_type_index == UINT32_MAX)
+	}
+
+	for(uint32_t type_index = 0; type_index < memory_properties->memoryTypeCount; type_index++)
+	{
+		VkMemoryType* type = &memory_properties->memoryTypes[type_index];
+		if((type->propertyFlags & direct_flags) == direct_flags
+			&& memory_properties->memoryHeaps[type->heapIndex].size == largest_device_local_heap_size)
+		{
+			allocator->device_local_host_visible = true;
+		}
+	}
+}
+
+// Picks the memory type allowed by type_bits that has every required flag and the most preferred
+// flags, favouring lower indices on ties as the spec orders types by performance.
+uint32_t vulkan_find_memory_type(
+	VulkanContext*        ctx, 
+	uint32_t              type_bits, 
+	VkMemoryPropertyFlags required_flags,
+	VkMemoryPropertyFlags preferred_flags)
+{
+	VkPhysicalDeviceMemoryProperties* properties = &ctx->memory_allocator.memory_properties;
+
+	uint32_t best_type_index = UINT32_MAX;
+	int32_t  best_score      = -1;
+	for(uint32_t type_index = 0; type_index < properties->memoryTypeCount; type_index++)
+	{
+		VkMemoryPropertyFlags flags = properties->memoryTypes[type_index].propertyFlags;
+		if(!(type_bits & (1 << type_index)) || (flags & required_flags) != required_flags)
+		{
+			continue;
+		}
+
+		int32_t score = __builtin_popcount(flags & preferred_flags);
+		if(score > best_score)
+		{
+			best_type_index = type_index;
+			best_score      = score;
+		}
+	}
+	if(best_type_index == UINT32_MAX)
 	{
 		panic();
 	}
 
-	VkMemoryAllocateInfo allocate_info = 
+	return best_type_index;
+}
+
+// Adds a range back to a block's free list, merging it with its neighbours and giving it back to
+// the linear head if it ends there.
+void vulkan_memory_block_release_range(VulkanMemoryBlock* block, VkDeviceSize offset, VkDeviceSize size)
+{
+	if(size == 0)
+	{
+		return;
+	}
+
+	uint32_t insert_index = 0;
+	while(insert_index < block->free_ranges_len && block->free_ranges[insert_index].offset < offset)
+	{
+		insert_index++;
+	}
+
+	bool merge_previous = insert_index > 0
+		&& block->free_ranges[insert_index - 1].offset + block->free_ranges[insert_index - 1].size == offset;
+	bool merge_next = insert_index < block->free_ranges_len
+		&& offset + size == block->free_ranges[insert_index].offset;
+
+	if(merge_previous && merge_next)
+	{
+		block->free_ranges[insert_index - 1].size += size + block->free_ranges[insert_index].size;
+		memmove(
+			&block->free_ranges[insert_index],
+			&block->free_ranges[insert_index + 1],
+			(block->free_ranges_len - insert_index - 1) * sizeof(VulkanMemoryRange));
+		block->free_ranges_len--;
+		insert_index--;
+	}
+	else if(merge_previous)
+	{
+		block->free_ranges[insert_index - 1].size += size;
+		insert_index--;
+	}
+	else if(merge_next)
+	{
+		block->free_ranges[insert_index].offset = offset;
+		block->free_ranges[insert_index].size  += size;
+	}
+	else
+	{
+		if(block->free_ranges_len == VULKAN_MEMORY_BLOCK_FREE_RANGES_MAX)
+		{
+			panic();
+		}
+
+		memmove(
+			&block->free_ranges[insert_index + 1],
+			&block->free_ranges[insert_index],
+			(block->free_ranges_len - insert_index) * sizeof(VulkanMemoryRange));
+		block->free_ranges[insert_index] = (VulkanMemoryRange){ offset, size };
+		block->free_ranges_len++;
+	}
+
+	// Only the last free range can touch the linear head.
+	VulkanMemoryRange* range = &block->free_ranges[insert_index];
+	if(insert_index == block->free_ranges_len - 1 && range->offset + range->size == block->linear_head)
+	{
+		block->linear_head = range->offset;
+		block->free_ranges_len--;
+	}
+}
+
+// Returns false if the block has no room for the allocation.
+bool vulkan_memory_block_allocate(
+	VulkanMemoryBlock*   block,
+	VkMemoryRequirements requirements,
+	VkDeviceSize*        offset)
+{
+	// First fit from the free list.
+	for(uint32_t range_index = 0; range_index < block->free_ranges_len; range_index++)
+	{
+		VulkanMemoryRange range   = block->free_ranges[range_index];
+		VkDeviceSize      aligned = vulkan_align_up(range.offset, requirements.alignment);
+
+		if(aligned + requirements.size > range.offset + range.size)
+		{
+			continue;
+		}
+
+		memmove(
+			&block->free_ranges[range_index],
+			&block->free_ranges[range_index + 1],
+			(block->free_ranges_len - range_index - 1) * sizeof(VulkanMemoryRange));
+		block->free_ranges_len--;
+
+		// Whatever is left on either side of the allocation goes back to the free list.
+		vulkan_memory_block_release_range(block, range.offset, aligned - range.offset);
+		vulkan_memory_block_release_range(
+			block,
+			aligned + requirements.size,
+			range.offset + range.size - (aligned + requirements.size));
+
+		*offset = aligned;
+		return true;
+	}
+
+	// Otherwise bump the linear head. Alignment padding is kept as a free range, as a smaller
+	// allocation might fit in it later.
+	VkDeviceSize aligned = vulkan_align_up(block->linear_head, requirements.alignment);
+	if(aligned + requirements.size > block->size)
+	{
+		return false;
+	}
+
+	VkDeviceSize padding_offset = block->linear_head;
+	block->linear_head = aligned + requirements.size;
+	vulkan_memory_block_release_range(block, padding_offset, aligned - padding_offset);
+
+	*offset = aligned;
+	return true;
+}
+
+void vulkan_create_memory_block(
+	VulkanContext*     ctx,
+	VulkanMemoryBlock* block,
+	VkDeviceSize       size,
+	uint32_t           type_index,
+	bool               linear,
+	bool               dedicated)
+{
+	VkMemoryAllocateInfo allocate_info =
 	{
 		.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
 		.pNext           = 0,
-		.allocationSize  = requirements.size,
-		.memoryTypeIndex = suitable_type_index
+		.allocationSize  = size,
+		.memoryTypeIndex = type_index
+	};
+
+	*block = (VulkanMemoryBlock)
+	{
+		.size       = size,
+		.type_index = type_index,
+		.linear     = linear,
+		.dedicated  = dedicated
+	};
+	vk_verify(vkAllocateMemory(ctx->device, &allocate_info, 0, &block->memory));
+
+	VkMemoryPropertyFlags property_flags = ctx->memory_allocator.memory_properties.memoryTypes[type_index].propertyFlags;
+	if(property_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		vk_verify(vkMapMemory(ctx->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+	}
+}
+
+// Sub-allocates memory of the type chosen by vulkan_find_memory_type. linear is true for buffers
+// and linearly tiled images.
+void vulkan_allocate_memory(
+	VulkanContext*        ctx,
+	VulkanAllocation*     allocation,
+	VkMemoryRequirements  requirements,
+	VkMemoryPropertyFlags required_flags,
+	VkMemoryPropertyFlags preferred_flags,
+	bool                  linear)
+{
+	VulkanMemoryAllocator* allocator = &ctx->memory_allocator;
+
+	uint32_t type_index = vulkan_find_memory_type(ctx, requirements.memoryTypeBits, required_flags, preferred_flags);
+	bool     segregate  = allocator->buffer_image_granularity > 1;
+
+	VkDeviceSize heap_size  = allocator->memory_properties.memoryHeaps[allocator->memory_properties.memoryTypes[type_index].heapIndex].size;
+	VkDeviceSize block_size = VULKAN_MEMORY_BLOCK_SIZE;
+	if(heap_size <= VULKAN_MEMORY_SMALL_HEAP_SIZE)
+	{
+		block_size = heap_size / 8;
+	}
+
+	// Try existing blocks first, remembering the first empty slot in case a new block is needed.
+	uint32_t empty_block_index = UINT32_MAX;
+	for(uint32_t block_index = 0; block_index < VULKAN_MEMORY_BLOCKS_MAX; block_index++)
+	{
+		VulkanMemoryBlock* block = &allocator->blocks[block_index];
+		if(block->memory == VK_NULL_HANDLE)
+		{
+			if(empty_block_index == UINT32_MAX)
+			{
+				empty_block_index = block_index;
+			}
+			continue;
+		}
+
+		if(block->dedicated
+			|| block->type_index != type_index
+			|| (segregate && block->linear != linear))
+		{
+			continue;
+		}
+
+		VkDeviceSize offset;
+		if(vulkan_memory_block_allocate(block, requirements, &offset))
+		{
+			block->used += requirements.size;
+			block->allocations_len++;
+
+			*allocation = (VulkanAllocation)
+			{
+				.memory      = block->memory,
+				.offset      = offset,
+				.size        = requirements.size,
+				.block_index = block_index,
+				.mapped      = block->mapped ? (uint8_t*)block->mapped + offset : 0
+			};
+			return;
+		}
+	}
+
+	if(empty_block_index == UINT32_MAX)
+	{
+		panic();
+	}
+
+	// Nothing had room, so create a new block. Resources larger than a block get one of their own,
+	// as do lazily allocated ones, whose memory is only committed as the device touches it and so
+	// is best sized to the resource.
+	VulkanMemoryBlock* block = &allocator->blocks[empty_block_index];
+	bool dedicated = requirements.size > block_size
+		|| (allocator->memory_properties.memoryTypes[type_index].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+	if(dedicated)
+	{
+		block_size = requirements.size;
+	}
+	vulkan_create_memory_block(ctx, block, block_size, type_index, linear, dedicated);
+
+	VkDeviceSize offset;
+	if(!vulkan_memory_block_allocate(block, requirements, &offset))
+	{
+		panic();
+	}
+	block->used += requirements.size;
+	block->allocations_len++;
+
+	*allocation = (VulkanAllocation)
+	{
+		.memory      = block->memory,
+		.offset      = offset,
+		.size        = requirements.size,
+		.block_index = empty_block_index,
+		.mapped      = block->mapped
 	};
-	vk_verify(vkAllocateMemory(ctx->device, &allocate_info, 0, memory));
+}
+
+void vulkan_free_memory(VulkanContext* ctx, VulkanAllocation* allocation)
+{
+	VulkanMemoryBlock* block = &ctx->memory_allocator.blocks[allocation->block_index];
+
+	block->used -= allocation->size;
+	block->allocations_len--;
+	vulkan_memory_block_release_range(block, allocation->offset, allocation->size);
+
+	// Regular blocks are kept around when they empty out, as the next frame or level is likely to
+	// want the memory back. Dedicated blocks are sized for one resource, so they are released.
+	if(block->dedicated && block->allocations_len == 0)
+	{
+		vkFreeMemory(ctx->device, block->memory, 0);
+		*block = (VulkanMemoryBlock){};
+	}
+
+	*allocation = (VulkanAllocation){};
+}
+
+VulkanMemoryStats vulkan_memory_stats(VulkanContext* ctx)
+{
+	VulkanMemoryStats stats = {};
+
+	for(uint32_t block_index = 0; block_index < VULKAN_MEMORY_BLOCKS_MAX; block_index++)
+	{
+		VulkanMemoryBlock* block = &ctx->memory_allocator.blocks[block_index];
+		if(block->memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		stats.blocks_len++;
+		stats.allocations_len += block->allocations_len;
+		stats.block_bytes     += block->size;
+		stats.used_bytes      += block->used;
+
+		for(uint32_t range_index = 0; range_index < block->free_ranges_len; range_index++)
+		{
+			VkDeviceSize size = block->free_ranges[range_index].size;
+
+			stats.fragmented_bytes += size;
+			if(size > stats.largest_fragment_bytes)
+			{
+				stats.largest_fragment_bytes = size;
+			}
+		}
+	}
+	stats.free_bytes = stats.block_bytes - stats.used_bytes;
+
+	return stats;
+}
+
+void vulkan_print_memory_stats(VulkanContext* ctx)
+{
+	VulkanMemoryStats stats = vulkan_memory_stats(ctx);
+
+	printf("Vulkan memory: %u allocations in %u blocks, %.2f/%.2f MiB used, %.2f MiB free, %.2f MiB fragmented (largest %.2f MiB)\n",
+		stats.allocations_len,
+		stats.blocks_len,
+		stats.used_bytes / (1024.0 * 1024.0),
+		stats.block_bytes / (1024.0 * 1024.0),
+		stats.free_bytes / (1024.0 * 1024.0),
+		stats.fragmented_bytes / (1024.0 * 1024.0),
+		stats.largest_fragment_bytes / (1024.0 * 1024.0));
 }
 
 void vulkan_allocate_memory_buffer(
 	VulkanContext*        ctx,
 	VulkanMemoryBuffer*   memory_buffer,
-	VkDeviceSize          size, 
-	VkBufferUsageFlags    usage_flags, 
-	VkMemoryPropertyFlags properties)
+	VkDeviceSize          size,
+	VkBufferUsageFlags    usage_flags,
+	VkMemoryPropertyFlags required_properties,
+	VkMemoryPropertyFlags preferred_properties)
 {
-	VkBufferCreateInfo buffer_create_info = 
+	VkBufferCreateInfo buffer_create_info =
 	{
 		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 		.pNext                 = 0,
@@ -57,21 +420,35 @@ void vulkan_allocate_memory_buffer(
 
 	vulkan_allocate_memory(
 		ctx,
-		&memory_buffer->memory,
-		requirements, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	vk_verify(vkBindBufferMemory(ctx->device, memory_buffer->buffer, memory_buffer->memory, 0));
+		&memory_buffer->allocation,
+		requirements,
+		required_properties,
+		preferred_properties,
+		true);
+	vk_verify(vkBindBufferMemory(
+		ctx->device,
+		memory_buffer->buffer,
+		memory_buffer->allocation.memory,
+		memory_buffer->allocation.offset));
+}
+
+void vulkan_free_memory_buffer(VulkanContext* ctx, VulkanMemoryBuffer* memory_buffer)
+{
+	vkDestroyBuffer(ctx->device, memory_buffer->buffer, 0);
+	vulkan_free_memory(ctx, &memory_buffer->allocation);
+	memory_buffer->buffer = VK_NULL_HANDLE;
 }
 
 void vulkan_allocate_image(
 	VulkanContext*        ctx,
 	VulkanAllocatedImage* allocated_image,
 	VkExtent2D            extent,
+	uint32_t              mip_levels,
 	VkFormat              format,
 	VkSampleCountFlagBits sample_count_flag_bits,
 	VkImageUsageFlags     usage_flags)
 {
-	VkImageCreateInfo image_create_info = 
+	VkImageCreateInfo image_create_info =
 	{
 		.sType 		           = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.pNext                 = 0,
@@ -79,7 +456,7 @@ void vulkan_allocate_image(
 		.imageType             = VK_IMAGE_TYPE_2D,
 		.format                = format,
 		.extent                = (VkExtent3D){ extent.width, extent.height, 1 },
-		.mipLevels             = 1,
+		.mipLevels             = mip_levels,
 		.arrayLayers           = 1,
 		.samples               = sample_count_flag_bits,
 		.tiling                = VK_IMAGE_TILING_OPTIMAL,
@@ -94,10 +471,41 @@ void vulkan_allocate_image(
 	VkMemoryRequirements requirements = {};
 	vkGetImageMemoryRequirements(ctx->device, allocated_image->image, &requirements);
 
+	// Transient attachments never leave tile memory on tile based devices, which expose lazily
+	// allocated memory for them that may never be backed at all. Elsewhere this falls back to
+	// regular device local memory.
 	vulkan_allocate_memory(
 		ctx,
-		&allocated_image->memory,
-		requirements, 
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	vk_verify(vkBindImageMemory(ctx->device, allocated_image->image, allocated_image->memory, 0));
+		&allocated_image->allocation,
+		requirements,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		(usage_flags & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0,
+		false);
+	vk_verify(vkBindImageMemory(
+		ctx->device,
+		allocated_image->image,
+		allocated_image->allocation.memory,
+		allocated_image->allocation.offset));
+}
+
+// The number of levels in a full mip chain, down to 1x1.
+uint32_t vulkan_mip_levels_for_extent(VkExtent2D extent)
+{
+	uint32_t size       = extent.width > extent.height ? extent.width : extent.height;
+	uint32_t mip_levels = 1;
+	while(size > 1)
+	{
+		size >>= 1;
+		mip_levels++;
+	}
+	return mip_levels;
+}
+
+void vulkan_free_image(VulkanContext* ctx, VulkanAllocatedImage* allocated_image)
+{
+	vkDestroyImageView(ctx->device, allocated_image->view, 0);
+	vkDestroyImage(ctx->device, allocated_image->image, 0);
+	vulkan_free_memory(ctx, &allocated_image->allocation);
+	allocated_image->view  = VK_NULL_HANDLE;
+	allocated_image->image = VK_NULL_HANDLE;
 }
@@ -0,0 +1,130 @@
+// Image and buffer barriers are collected into a VulkanBarrierBatch and recorded together with a
+// single vkCmdPipelineBarrier2 when the batch is flushed, so that the driver sees every transition
+// between two groups of commands at once.
+//
+// Barriers within a batch are not ordered against one another, so two barriers on the same
+// subresource must be split by a flush.
+//
+// A barrier with differing queue families transfers ownership of the resource between them, in
+// which case the same barrier must be recorded on both queues: as a release on the source queue and
+// as an acquire on the destination queue. The release's destination stages and the acquire's source
+// stages are ignored, and should be left as NONE.
+
+void vulkan_begin_barrier_batch(VulkanBarrierBatch* batch, VkCommandBuffer command_buffer)
+{
+	batch->command_buffer      = command_buffer;
+	batch->image_barriers_len  = 0;
+	batch->buffer_barriers_len = 0;
+}
+
+void vulkan_flush_barrier_batch(VulkanBarrierBatch* batch)
+{
+	if(batch->image_barriers_len == 0 && batch->buffer_barriers_len == 0)
+	{
+		return;
+	}
+
+	VkDependencyInfo dependency_info =
+	{
+		.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.pNext                    = 0,
+		.dependencyFlags          = 0,
+		.memoryBarrierCount       = 0,
+		.pMemoryBarriers          = 0,
+		.bufferMemoryBarrierCount = batch->buffer_barriers_len,
+		.pBufferMemoryBarriers    = batch->buffer_barriers,
+		.imageMemoryBarrierCount  = batch->image_barriers_len,
+		.pImageMemoryBarriers     = batch->image_barriers
+	};
+	vkCmdPipelineBarrier2(batch->command_buffer, &dependency_info);
+
+	batch->image_barriers_len  = 0;
+	batch->buffer_barriers_len = 0;
+}
+
+// The given mip levels of an image, across every array layer.
+VkImageSubresourceRange vulkan_image_levels(VkImageAspectFlags aspect_flags, uint32_t base_mip_level, uint32_t level_count)
+{
+	return (VkImageSubresourceRange)
+	{
+		.aspectMask     = aspect_flags,
+		.baseMipLevel   = base_mip_level,
+		.levelCount     = level_count,
+		.baseArrayLayer = 0,
+		.layerCount     = VK_REMAINING_ARRAY_LAYERS
+	};
+}
+
+// Every mip level and array layer of an image.
+VkImageSubresourceRange vulkan_image_subresources(VkImageAspectFlags aspect_flags)
+{
+	return vulkan_image_levels(aspect_flags, 0, VK_REMAINING_MIP_LEVELS);
+}
+
+void vulkan_batch_image_barrier(
+	VulkanBarrierBatch*     batch,
+	VkImage                 image,
+	VkImageSubresourceRange subresource_range,
+	VkImageLayout           old_layout,
+	VkImageLayout           new_layout,
+	VkPipelineStageFlags2   src_stages,
+	VkAccessFlags2          src_access,
+	VkPipelineStageFlags2   dst_stages,
+	VkAccessFlags2          dst_access,
+	uint32_t                src_queue_family,
+	uint32_t                dst_queue_family)
+{
+	if(batch->image_barriers_len == VULKAN_BARRIER_BATCH_IMAGES_MAX)
+	{
+		vulkan_flush_barrier_batch(batch);
+	}
+
+	batch->image_barriers[batch->image_barriers_len++] = (VkImageMemoryBarrier2)
+	{
+		.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.pNext               = 0,
+		.srcStageMask        = src_stages,
+		.srcAccessMask       = src_access,
+		.dstStageMask        = dst_stages,
+		.dstAccessMask       = dst_access,
+		.oldLayout           = old_layout,
+		.newLayout           = new_layout,
+		.srcQueueFamilyIndex = src_queue_family,
+		.dstQueueFamilyIndex = dst_queue_family,
+		.image               = image,
+		.subresourceRange    = subresource_range
+	};
+}
+
+void vulkan_batch_buffer_barrier(
+	VulkanBarrierBatch*   batch,
+	VkBuffer              buffer,
+	VkDeviceSize          offset,
+	VkDeviceSize          size,
+	VkPipelineStageFlags2 src_stages,
+	VkAccessFlags2        src_access,
+	VkPipelineStageFlags2 dst_stages,
+	VkAccessFlags2        dst_access,
+	uint32_t              src_queue_family,
+	uint32_t              dst_queue_family)
+{
+	if(batch->buffer_barriers_len == VULKAN_BARRIER_BATCH_BUFFERS_MAX)
+	{
+		vulkan_flush_barrier_batch(batch);
+	}
+
+	batch->buffer_barriers[batch->buffer_barriers_len++] = (VkBufferMemoryBarrier2)
+	{
+		.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		.pNext               = 0,
+		.srcStageMask        = src_stages,
+		.srcAccessMask       = src_access,
+		.dstStageMask        = dst_stages,
+		.dstAccessMask       = dst_access,
+		.srcQueueFamilyIndex = src_queue_family,
+		.dstQueueFamilyIndex = dst_queue_family,
+		.buffer              = buffer,
+		.offset              = offset,
+		.size                = size
+	};
+}
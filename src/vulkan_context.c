@@ -1,49 +1,184 @@
+#include <pthread.h>
+
+typedef struct
+{
+	VkDeviceSize offset;
+	VkDeviceSize size;
+} VulkanMemoryRange;
+
+// One large VkDeviceMemory allocation that resources are sub-allocated from. Memory below
+// linear_head is either in use or listed in free_ranges; memory above it has never been handed out
+// since the block was last empty.
+typedef struct
+{
+	VkDeviceMemory    memory;
+	VkDeviceSize      size;
+	uint32_t          type_index;
+	// Whether the block holds buffers and linear images, as opposed to optimally tiled images.
+	// Only meaningful when the device has a bufferImageGranularity above 1.
+	bool              linear;
+	// Dedicated blocks hold one resource that is too large for a regular block, and are released
+	// as soon as that resource is freed.
+	bool              dedicated;
+	// Persistently mapped for the lifetime of the block if the memory type is host visible.
+	void*             mapped;
+
+	VkDeviceSize      linear_head;
+	VkDeviceSize      used;
+	uint32_t          allocations_len;
+
+	// Sorted by offset, never adjacent to one another or to linear_head.
+	VulkanMemoryRange free_ranges[VULKAN_MEMORY_BLOCK_FREE_RANGES_MAX];
+	uint32_t          free_ranges_len;
+} VulkanMemoryBlock;
+
+typedef struct
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	VkDeviceSize                     buffer_image_granularity;
+	// Whether the largest device local heap is also host visible (ReBAR or UMA), in which case
+	// device local buffers can be written directly instead of through a staging buffer.
+	bool                             device_local_host_visible;
+
+	// A block with a null memory handle is an empty slot.
+	VulkanMemoryBlock                blocks[VULKAN_MEMORY_BLOCKS_MAX];
+} VulkanMemoryAllocator;
+
 typedef struct
 {
-	VkBuffer       buffer;
 	VkDeviceMemory memory;
+	VkDeviceSize   offset;
+	VkDeviceSize   size;
+	uint32_t       block_index;
+	// Null unless the memory type is host visible.
+	void*          mapped;
+} VulkanAllocation;
+
+typedef struct
+{
+	uint32_t     blocks_len;
+	uint32_t     allocations_len;
+	// Total device memory held by the allocator, split into used and free bytes.
+	VkDeviceSize block_bytes;
+	VkDeviceSize used_bytes;
+	VkDeviceSize free_bytes;
+	// The part of free_bytes that sits in holes between live allocations rather than at the end of a
+	// block.
+	VkDeviceSize fragmented_bytes;
+	VkDeviceSize largest_fragment_bytes;
+} VulkanMemoryStats;
+
+typedef struct
+{
+	VkBuffer         buffer;
+	VulkanAllocation allocation;
 } VulkanMemoryBuffer;
 
 typedef struct
 {
-	VkImage         image;
-	VkImageView     view;
-	VkDeviceMemory  memory;
+	VkImage          image;
+	VkImageView      view;
+	VulkanAllocation allocation;
 } VulkanAllocatedImage;
 
 typedef struct
 {
+	// Compiled by a pipeline worker, so only read through vulkan_pipeline_for_draw or
+	// vulkan_wait_for_pipeline. Until it is built, draws can use the placeholder, a cheaper
+	// pipeline with the same layout, if one was requested.
 	VkPipeline            pipeline;
+	VkPipeline            placeholder;
+	// Written by pipeline workers, under VulkanPipelineBuilder.mutex.
+	bool                  built;
+	bool                  placeholder_built;
+
 	VkPipelineLayout      layout;
 
 	VkDescriptorSetLayout descriptor_set_layout; // CONSIDER - not used outside of pipeline creation
 	VkDescriptorPool      descriptor_pool;       // < also not used outside of pipeline creation
-	VkDescriptorSet       descriptor_set;
+	// One set per frame in flight, each pointing at that frame's slice of host mapped memory.
+	VkDescriptorSet       descriptor_sets[FRAMES_IN_FLIGHT_COUNT];
 } VulkanPipeline;
 
+// Everything a single frame in flight needs in order to be recorded while other frames are still
+// being rendered by the GPU.
+typedef struct
+{
+	VkCommandBuffer command_buffer;
+
+	// Signaled when the GPU has finished with this frame's command buffer and host mapped data.
+	VkFence         in_flight_fence;
+	VkSemaphore     image_available_semaphore;
+} VulkanFrame;
+
 typedef struct
 {
-	alignas(16) mat4 view;
-	alignas(16) mat4 projection;
-	alignas(16) Vec3 clear_color;
+	alignas(16) mat4     view;
+	alignas(16) mat4     projection;
+	alignas(16) mat4     view_projection;
+	alignas(16) Vec3     clear_color;
+	uint32_t             instances_len; // packs into clear_color's padding under std140
 } VulkanHostMappedGlobal;
 
+// Models are grouped by mesh index. The culling compute shader reads models and mesh indices, and
+// the vertex shader reads models and material indices through the visible instance list the
+// culling shader writes.
 typedef struct
 {
-	alignas(16) mat4 models[STATIC_MESHES_LEN];
+	alignas(16)  mat4     models[STATIC_MESHES_LEN];
+	alignas(256) uint32_t mesh_indices[STATIC_MESHES_LEN];
+	alignas(256) uint32_t material_indices[STATIC_MESHES_LEN];
 } VulkanHostMappedInstance;
 
+// Indexed by material handle. Texture indices are slots in the world pipeline's texture array,
+// which point at the placeholder until the material's texture is resident.
+typedef struct
+{
+	uint32_t texture_indices[MATERIAL_ASSETS_LEN];
+} VulkanHostMappedMaterial;
+
+// Per mesh culling inputs. The draw commands are templates with an instance count of zero, which
+// are copied into the device local VulkanCullData before culling runs. Each mesh's visible
+// instances are written from first_visible_instances onwards.
+typedef struct
+{
+	alignas(16)  Vec4                         bounds[MESHES_COUNT]; // xyz is center, w is radius
+	uint32_t                                  first_visible_instances[MESHES_COUNT];
+	alignas(256) VkDrawIndexedIndirectCommand draw_commands[MESHES_COUNT];
+} VulkanHostMappedMesh;
+
+// VOLATILE - Must match the push_constant block in world.vert.
+typedef struct
+{
+	uint32_t first_visible_instance;
+} VulkanDrawPushConstants;
+
+// One of these exists per frame in flight. Members are aligned to 256 bytes, the largest value the
+// spec allows for min(Uniform|Storage)BufferOffsetAlignment, so that each can be bound directly.
 typedef struct
 {
-	alignas(64) VulkanHostMappedGlobal   global;
-	alignas(64) VulkanHostMappedInstance instance;
+	alignas(256) VulkanHostMappedGlobal   global;
+	alignas(256) VulkanHostMappedInstance instance;
+	alignas(256) VulkanHostMappedMesh     mesh;
+	alignas(256) VulkanHostMappedMaterial material;
 } VulkanHostMappedData;
 
+// Device local output of the culling compute shader, one per frame in flight. Draw commands are
+// consumed by vkCmdDrawIndexedIndirect and visible instances index into the host mapped models.
 typedef struct
 {
-	Vec3 position;
-	Vec2 texture_uv;
-} VulkanMeshVertex;
+	alignas(256) VkDrawIndexedIndirectCommand draw_commands[MESHES_COUNT];
+	alignas(256) uint32_t                     visible_instances[STATIC_MESHES_LEN];
+} VulkanCullData;
+
+// world_cull.comp declares both of the above with std430, which only lays them out the same way
+// while these hold.
+_Static_assert(offsetof(VulkanHostMappedMesh, first_visible_instances) == MESHES_COUNT * sizeof(Vec4),
+	"first_visible_instances must directly follow bounds");
+_Static_assert(sizeof(VkDrawIndexedIndirectCommand) == 5 * sizeof(uint32_t),
+	"DrawCommand in world_cull.comp must match VkDrawIndexedIndirectCommand");
+_Static_assert(offsetof(VulkanCullData, visible_instances) == (MESHES_COUNT * sizeof(VkDrawIndexedIndirectCommand) + 255) / 256 * 256,
+	"visible_instances must be at the first 256 byte boundary after draw_commands");
 
 // NOW - this might be good as is, but remember that its been renamed and changed to only include
 // data which is used at loop time, as opposed to that needed during initialization.
@@ -53,14 +188,343 @@ typedef struct
 // initialization (as part of VulkanMeshData, perhaps).
 typedef struct
 {
-	uint32_t vertices_len;
-	uint32_t indices_len;
+	uint32_t    vertices_len;
+	uint32_t    indices_len;
+	VkIndexType index_type;
+
+	Vec3        bounds_center;
+	float       bounds_radius;
 
-	// TODO - Will be used for when multiple meshes.
-	uint32_t vertex_buffer_offset;
-	uint32_t index_buffer_offset;
+	uint32_t    vertex_buffer_offset;
+	// Positions alone, tightly packed, for the depth pre-pass.
+	uint32_t    position_buffer_offset;
+	uint32_t    index_buffer_offset;
 } VulkanAllocatedMesh;
 
+// One registered mesh asset path, and the unique mesh it resolved to. Lookups go by path first, and
+// by content hash when a new path is loaded, so that identical meshes share one VulkanAllocatedMesh.
+typedef struct
+{
+	char*    path;
+	uint64_t content_hash;
+	uint32_t mesh_index;
+} VulkanMeshRegistryEntry;
+
+// A span of the staging ring which the transfer queue may still be reading from. Everything before
+// end is released once the transfer timeline reaches timeline_value.
+typedef struct
+{
+	uint64_t end;
+	uint64_t timeline_value;
+} VulkanStagingRegion;
+
+// Persistently mapped upload memory, used as a ring. Positions count bytes since the ring was
+// created, so head - tail is the number of bytes in use and a position's offset in the buffer is the
+// position modulo size.
+typedef struct
+{
+	VulkanMemoryBuffer  buffer;
+	VkDeviceSize        size;
+
+	uint64_t            head;
+	uint64_t            tail;
+	// The position up to which allocations have been handed to a region.
+	uint64_t            retired;
+
+	// FIFO of regions awaiting completion, oldest first.
+	VulkanStagingRegion regions[VULKAN_STAGING_REGIONS_MAX];
+	uint32_t            regions_first;
+	uint32_t            regions_len;
+} VulkanStagingRing;
+
+// One command buffer's worth of uploads on the transfer queue.
+typedef struct
+{
+	VkCommandBuffer command_buffer;
+	// The batch may be recorded again once the transfer timeline reaches this value.
+	uint64_t        timeline_value;
+} VulkanTransferBatch;
+
+// See vulkan_barrier_batch.c.
+typedef struct
+{
+	VkCommandBuffer        command_buffer;
+	VkImageMemoryBarrier2  image_barriers[VULKAN_BARRIER_BATCH_IMAGES_MAX];
+	uint32_t               image_barriers_len;
+	VkBufferMemoryBarrier2 buffer_barriers[VULKAN_BARRIER_BATCH_BUFFERS_MAX];
+	uint32_t               buffer_barriers_len;
+} VulkanBarrierBatch;
+
+// The acquire half of a buffer ownership transfer from the transfer queue family, to be recorded on
+// the graphics queue before the buffer is used.
+typedef struct
+{
+	VkBuffer              buffer;
+	VkDeviceSize          offset;
+	VkDeviceSize          size;
+	VkPipelineStageFlags2 dst_stages;
+	VkAccessFlags2        dst_access;
+	// The transfer timeline value of the release, which the acquiring submission waits on.
+	uint64_t              timeline_value;
+} VulkanBufferAcquire;
+
+typedef struct
+{
+	char*          path;
+	uint64_t       path_hash;
+	VkShaderModule module;
+} VulkanShaderModuleEntry;
+
+typedef enum
+{
+	VULKAN_PIPELINE_JOB_GRAPHICS,
+	VULKAN_PIPELINE_JOB_COMPUTE
+} VulkanPipelineJobType;
+
+// Everything a pipeline worker needs to compile a pipeline, copied out of the caller's configs
+// so that they needn't outlive the call.
+typedef struct
+{
+	VulkanPipelineJobType             type;
+	VulkanPipeline*                   pipeline;
+	// Compiles pipeline->placeholder rather than pipeline->pipeline.
+	bool                              placeholder;
+
+	VkShaderModule                    vertex_shader;
+	VkShaderModule                    fragment_shader;
+	VkShaderModule                    compute_shader;
+
+	VkVertexInputAttributeDescription vertex_input_attribute_descriptions[VULKAN_VERTEX_INPUT_ATTRIBUTES_MAX];
+	uint8_t                           vertex_input_attributes_len;
+	size_t                            vertex_data_stride;
+	VkFormat                          color_format;
+	VkSampleCountFlagBits             samples;
+	VkCompareOp                       depth_compare_op;
+	bool                              depth_write;
+} VulkanPipelineJob;
+
+// Pipelines are compiled by a pool of worker threads, which take jobs from a queue. Creating a
+// pipeline only queues it, and the pipeline cache is saved once the queue has drained.
+typedef struct
+{
+	pthread_t         workers[VULKAN_PIPELINE_WORKERS_MAX];
+	uint32_t          workers_len;
+	pthread_mutex_t   mutex;
+	pthread_cond_t    queued_condition;
+	pthread_cond_t    built_condition;
+
+	VulkanPipelineJob queue[VULKAN_PIPELINE_JOBS_MAX];
+	uint32_t          queue_first;
+	uint32_t          queue_len;
+	// Jobs queued or being compiled.
+	uint32_t          pending_len;
+
+	// Every graphics job as it was first queued, so that the pipelines can be recompiled when
+	// something baked into them, such as the sample count, changes.
+	VulkanPipelineJob graphics_jobs[VULKAN_PIPELINE_JOBS_MAX];
+	uint32_t          graphics_jobs_len;
+
+	// Only touched by the main thread.
+	bool              cache_saved;
+} VulkanPipelineBuilder;
+
+typedef enum
+{
+	VULKAN_TEXTURE_STATE_EMPTY,
+	// Queued for or being loaded by the load thread, or loaded and waiting for room in the staging
+	// ring.
+	VULKAN_TEXTURE_STATE_LOADING,
+	// Copy submitted on the transfer queue.
+	VULKAN_TEXTURE_STATE_UPLOADING,
+	VULKAN_TEXTURE_STATE_RESIDENT
+} VulkanTextureState;
+
+// Texture levels ready to be copied into an image: either blocks mapped straight from a cooked
+// texture file (see texture.c), or pixels decoded from them when the device can't sample the file's
+// block format. Released with vulkan_free_texture_data once uploaded.
+typedef struct
+{
+	void*        mapping;
+	size_t       mapping_size;
+	// RGBA8 pixels for every level, if the blocks had to be decoded.
+	void*        decoded;
+
+	VkFormat     format;
+	VkExtent2D   extent;
+	// Levels with data, largest first. If this is short of the full chain, only level 0 is
+	// uploaded and the rest are generated from it.
+	uint32_t     mip_levels;
+	void*        levels[TEXTURE_FILE_LEVELS_MAX];
+	VkDeviceSize level_sizes[TEXTURE_FILE_LEVELS_MAX];
+} VulkanTextureData;
+
+typedef struct
+{
+	// Only touched by the main thread.
+	VulkanTextureState   state;
+	char*                path;
+	VulkanAllocatedImage image;
+	VkExtent2D           extent;
+	uint32_t             mip_levels;
+	// The transfer timeline value which signals that the upload has completed.
+	uint64_t             upload_timeline_value;
+	// Set from upload until the graphics queue has taken the image over, acquiring it from the
+	// transfer queue family if needed and generating its mip chain if needed.
+	bool                 acquire_pending;
+	// Set when only level 0 was uploaded.
+	bool                 generate_mips;
+	// Set once the texture's slot in the texture array has been written, after which materials
+	// can sample it.
+	bool                 bound;
+
+	// Written by the load thread, under VulkanTextureStream.mutex.
+	bool                 loaded;
+	VulkanTextureData    data;
+} VulkanTexture;
+
+// Texture loading happens on a worker thread, which picks up texture paths from a queue and hands
+// back texture data ready for upload. Everything touching the Vulkan device stays on the main
+// thread.
+typedef struct
+{
+	pthread_t       load_thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t  queued_condition;
+	// Set when the device can't sample BC formats, so cooked blocks have to be decoded.
+	bool            decode_blocks;
+
+	VulkanTexture*  load_queue[TEXTURES_COUNT];
+	uint32_t        load_queue_first;
+	uint32_t        load_queue_len;
+} VulkanTextureStream;
+
+// What a render graph pass does with a resource. Each bit maps to the stages, accesses and image
+// layout of that use in vulkan_resource_usage_state.
+typedef enum
+{
+	VULKAN_RESOURCE_USAGE_TRANSFER_WRITE_BIT     = 1 << 0,
+	VULKAN_RESOURCE_USAGE_COMPUTE_READ_BIT       = 1 << 1,
+	VULKAN_RESOURCE_USAGE_COMPUTE_WRITE_BIT      = 1 << 2,
+	VULKAN_RESOURCE_USAGE_INDIRECT_READ_BIT      = 1 << 3,
+	VULKAN_RESOURCE_USAGE_VERTEX_SHADER_READ_BIT = 1 << 4,
+	VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT   = 1 << 5,
+	VULKAN_RESOURCE_USAGE_DEPTH_ATTACHMENT_BIT   = 1 << 6,
+	// Only valid as an imported image's final usage.
+	VULKAN_RESOURCE_USAGE_PRESENT_BIT            = 1 << 7
+} VulkanResourceUsageFlagBits;
+typedef uint32_t VulkanResourceUsageFlags;
+
+// Synchronization state of a resource: the last write, which every later use has to wait on, and
+// the reads since then, which the next write has to wait on. The reads have all seen the write.
+typedef struct
+{
+	VkPipelineStageFlags2 write_stages;
+	VkAccessFlags2        write_access;
+	VkPipelineStageFlags2 read_stages;
+	VkAccessFlags2        read_access;
+	// Images only.
+	VkImageLayout         layout;
+} VulkanResourceState;
+
+// Backs the graph's transient images. These persist across frames, and are handed to any
+// transient with the same description whose lifetime doesn't overlap those already given the
+// image this frame.
+typedef struct
+{
+	VulkanAllocatedImage  image;
+	VkFormat              format;
+	VkExtent2D            extent;
+	VkSampleCountFlagBits samples;
+	VkImageUsageFlags     usage;
+	VkImageAspectFlags    aspect;
+	// Where the last use left the image. Frames in flight share the images, so the first use in a
+	// frame still has to wait on the previous frame's.
+	VulkanResourceState   state;
+	// The last pass using the image this frame, or -1 while it is free.
+	int32_t               last_pass;
+} VulkanRenderGraphImage;
+
+typedef enum
+{
+	VULKAN_RENDER_GRAPH_RESOURCE_IMAGE,
+	VULKAN_RENDER_GRAPH_RESOURCE_BUFFER
+} VulkanRenderGraphResourceType;
+
+typedef struct
+{
+	VulkanRenderGraphResourceType type;
+	// Transient images are created by the graph, and live only as long as the passes using them.
+	bool                     transient;
+	VulkanResourceState      state;
+	// The usage imported resources are left in after the last pass, or 0 if they are only used by
+	// the graph. Resources with a final usage are the graph's outputs.
+	VulkanResourceUsageFlags final_usage;
+
+	VkImage                  image;
+	VkImageView              view;
+	VkImageAspectFlags       aspect;
+	VkFormat                 format;
+	VkSampleCountFlagBits    samples;
+	// Transients only: every usage of the image by kept passes, and the index of the graph image
+	// backing it.
+	VkImageUsageFlags        image_usage;
+	uint32_t                 physical_image;
+
+	VkBuffer                 buffer;
+	VkDeviceSize             offset;
+	VkDeviceSize             size;
+
+	// First and last kept pass using the resource, or -1 if none is.
+	int32_t                  first_pass;
+	int32_t                  last_pass;
+} VulkanRenderGraphResource;
+
+typedef struct
+{
+	uint32_t                 resource;
+	VulkanResourceUsageFlags usage;
+} VulkanRenderGraphAccess;
+
+typedef struct
+{
+	char*                   name;
+	void                    (*record)(VkCommandBuffer command_buffer, void* data);
+	void*                   data;
+	VulkanRenderGraphAccess accesses[VULKAN_RENDER_GRAPH_PASS_ACCESSES_MAX];
+	uint32_t                accesses_len;
+	bool                    culled;
+} VulkanRenderGraphPass;
+
+// Passes and resources are declared anew every frame, between vulkan_begin_render_graph and
+// vulkan_execute_render_graph. Only the transient images persist.
+typedef struct
+{
+	VkExtent2D                extent;
+	VulkanRenderGraphPass     passes[VULKAN_RENDER_GRAPH_PASSES_MAX];
+	uint32_t                  passes_len;
+	VulkanRenderGraphResource resources[VULKAN_RENDER_GRAPH_RESOURCES_MAX];
+	uint32_t                  resources_len;
+	// The pass being recorded during execution.
+	int32_t                   recording_pass;
+
+	VulkanRenderGraphImage    images[VULKAN_RENDER_GRAPH_IMAGES_MAX];
+	uint32_t                  images_len;
+} VulkanRenderGraph;
+
+// A swapchain replaced by recreation, with the views and render graph images which went with it.
+typedef struct
+{
+	VkSwapchainKHR       swapchain;
+	VkImageView          image_views               [SWAPCHAIN_IMAGES_COUNT];
+	VkSemaphore          render_finished_semaphores[SWAPCHAIN_IMAGES_COUNT];
+	uint32_t             image_views_len;
+	VulkanAllocatedImage images[VULKAN_RENDER_GRAPH_IMAGES_MAX];
+	uint32_t             images_len;
+	// VulkanContext.frames_submitted when it was retired. Every frame which used it was submitted
+	// before then.
+	uint64_t             frames_submitted;
+} VulkanRetiredSwapchain;
+
 typedef struct 
 {
 	VkInstance            instance;
@@ -70,6 +534,12 @@ typedef struct
 
 	VkQueue               graphics_queue;
 	VkQueue               present_queue;
+	// A transfer only queue if the device has one, otherwise the graphics queue.
+	VkQueue               transfer_queue;
+	uint32_t              graphics_family_index;
+	uint32_t              transfer_family_index;
+
+	VulkanMemoryAllocator memory_allocator;
 
 	VkSurfaceKHR          surface;
 	VkSurfaceFormatKHR    surface_format;
@@ -78,33 +548,99 @@ typedef struct
 	VkExtent2D            swapchain_extent;
 	VkImageView           swapchain_image_views[SWAPCHAIN_IMAGES_COUNT];
 	VkImage               swapchain_images     [SWAPCHAIN_IMAGES_COUNT];
-
-	VkSemaphore           image_available_semaphore;
-	VkSemaphore           render_finished_semaphore;
+	// Signaled by the frame rendering to each image and waited on by its present. These are per
+	// image rather than per frame in flight, as the frame's fence doesn't cover the presentation
+	// engine's wait: a semaphore can only be signaled again once its image has been acquired again.
+	VkSemaphore           swapchain_render_finished_semaphores[SWAPCHAIN_IMAGES_COUNT];
+	uint32_t              swapchain_images_len;
+	VulkanRetiredSwapchain retired_swapchains[VULKAN_RETIRED_SWAPCHAINS_MAX];
+	uint32_t               retired_swapchains_len;
 
 	VkCommandPool         command_pool;
-	VkCommandBuffer       main_command_buffer;
+	VulkanFrame           frames[FRAMES_IN_FLIGHT_COUNT];
+	uint8_t               frame_index;
+	// Graphics submissions made by vulkan_loop so far.
+	uint64_t              frames_submitted;
 
-	VulkanAllocatedImage  render_image;
-	VulkanAllocatedImage  depth_image;
+	// Owns the render and depth attachments, which are transient images sized to the swapchain.
+	VulkanRenderGraph     render_graph;
 
+	// Shared by every pipeline creation, and persisted across runs.
+	VkPipelineCache       pipeline_cache;
+	VulkanPipelineBuilder pipeline_builder;
+	// Every shader module loaded so far, which live as long as the device so that pipelines can
+	// be recreated without reloading them.
+	VulkanShaderModuleEntry shader_modules[VULKAN_SHADER_MODULES_MAX];
+	uint32_t                shader_modules_len;
 	VulkanPipeline        pipelines[PIPELINES_COUNT];
+	VulkanPipeline        cull_pipeline;
+	// With the depth pre-pass on, the world is first drawn depth only, then shaded with
+	// depth_equal_pipeline, which only shades the visible surface of each pixel.
+	VulkanPipeline        depth_prepass_pipeline;
+	VulkanPipeline        depth_equal_pipeline;
 	VkSampler             texture_sampler;
 
-	VulkanAllocatedMesh   allocated_meshes[1];
+	VulkanAllocatedMesh   allocated_meshes[MESHES_COUNT];
+	uint32_t              meshes_len;
 	VulkanMemoryBuffer    mesh_data_memory_buffer;
 
+	// Maps asset handles (see mesh_asset_paths) to indices into allocated_meshes.
+	uint32_t                asset_mesh_indices[MESH_ASSETS_LEN];
+	VulkanMeshRegistryEntry mesh_registry[MESH_ASSETS_LEN];
+	uint32_t                mesh_registry_len;
+
+	// Uploads. The timeline semaphore is signaled by every transfer batch submission, with
+	// transfer_timeline_value being the last value submitted.
+	VkCommandPool         transfer_command_pool;
+	VulkanTransferBatch   transfer_batches[VULKAN_TRANSFER_BATCHES_COUNT];
+	// The batch being recorded, or null between submissions.
+	VulkanTransferBatch*  transfer_batch;
+	VkSemaphore           transfer_timeline;
+	uint64_t              transfer_timeline_value;
+	VulkanStagingRing     staging_ring;
+	VulkanBufferAcquire   buffer_acquires[VULKAN_BUFFER_ACQUIRES_MAX];
+	uint32_t              buffer_acquires_len;
+
 	// CONSIDER - Ought this be part of VulkanAllocatedMesh?
-	VulkanAllocatedImage  texture_images[1];
+	VulkanTexture         textures[TEXTURES_COUNT];
+	// Linear if the texture format supports filtered blits, which it nearly always does.
+	VkFilter              texture_mip_filter;
+	VulkanTextureStream   texture_stream;
 
+	// Holds FRAMES_IN_FLIGHT_COUNT consecutive VulkanHostMappedData slices.
 	VulkanMemoryBuffer    host_mapped_buffer;
 	// CONSIDER - Does this need to be void*? Why not just do the struct?
 	void*                 host_mapped_data;
 
+	// Holds FRAMES_IN_FLIGHT_COUNT consecutive VulkanCullData slices.
+	VulkanMemoryBuffer    cull_memory_buffer;
+
 	// Used in swapchain initialization.
 	// 
 	// TODO - Localize to create swapchain function. Surely anything that breaks should be
 	// included in swapchain creation?
 	float                 device_max_sampler_anisotropy;
-	VkSampleCountFlagBits device_framebuffer_sample_counts;
+	// Sample counts supported by both color and depth attachments.
+	VkSampleCountFlags    device_framebuffer_sample_counts;
+	// The sample count of the current MSAA tier, which the attachments and graphics pipelines are
+	// built for.
+	VkSampleCountFlagBits msaa_samples;
+	// Whether the last frame was drawn with the depth pre-pass, which lags the render list until the
+	// pre-pass pipeline is built.
+	bool                  depth_prepass;
 } VulkanContext;
+
+// Everything the frame's render graph passes record from.
+typedef struct
+{
+	VulkanContext*     ctx;
+	RenderList*        render_list;
+	VulkanRenderGraph* graph;
+	VkDeviceSize       cull_data_offset;
+	uint32_t*          mesh_first_visible_instances;
+	uint32_t           image_index;
+
+	uint32_t           swapchain_resource;
+	uint32_t           color_resource;
+	uint32_t           depth_resource;
+} VulkanFramePassData;
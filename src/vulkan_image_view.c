@@ -15,7 +15,7 @@ void vulkan_create_image_view(
 		{
 			.aspectMask     = aspect_flags,
 			.baseMipLevel   = 0,
-			.levelCount     = 1,
+			.levelCount     = VK_REMAINING_MIP_LEVELS,
 			.baseArrayLayer = 0,
 			.layerCount     = 1
 		}
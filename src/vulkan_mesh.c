@@ -1,99 +1,128 @@
-#define MESH_VERTEX_STRIDE sizeof(VulkanMeshVertex)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#define LOAD_MESH_VERTEX_BUFFER_LEN 64000
-#define LOAD_MESH_INDEX_BUFFER_LEN  64000
+#define MESH_VERTEX_STRIDE sizeof(MeshVertex)
 
-// Holds the raw vertex/index data as well as whatever else might be stored as a result of loading
-// the obj file.
-// This is strictly data which is no longer needed after initialization.
+// A cooked mesh file (see mesh.c), mapped into memory. vertices and indices point straight into
+// the mapping and are ready to be copied into an upload buffer as they are.
+// This is strictly data which is no longer needed after initialization, and is released with
+// vulkan_free_mesh_data once it has been uploaded.
 typedef struct
 {
-	VulkanMeshVertex vertices[LOAD_MESH_VERTEX_BUFFER_LEN];
-	uint32_t         vertices_len;
-	
-	uint32_t         indices[LOAD_MESH_INDEX_BUFFER_LEN];
-	uint32_t         indices_len;
+	void*       mapping;
+	size_t      mapping_size;
+
+	MeshVertex* vertices;
+	uint32_t    vertices_len;
+
+	// uint16_t or uint32_t, as given by index_type.
+	void*       indices;
+	uint32_t    indices_len;
+	VkIndexType index_type;
+	uint32_t    index_size;
+
+	// Bounding sphere in mesh space, used for culling.
+	Vec3        bounds_center;
+	float       bounds_radius;
+
+	uint64_t    content_hash;
 } VulkanMeshData;
 
 void vulkan_load_mesh(VulkanMeshData* data, char* mesh_filename)
 {
-	FILE* file = fopen(mesh_filename, "r");
-	if(file == NULL)
+	int32_t file = open(mesh_filename, O_RDONLY);
+	if(file == -1)
 	{
+		printf("Failed to open file: %s\n", mesh_filename);
 		panic();
 	}
 
-	// The tricky thing about .obj is texture UVs being defined per index buffer vertex, as opposted
-	// to being defined per vertex buffer vertex, you see.
-	// 
-	// To fix this, we'll apply the proper UVs and whatnot to the vertex buffer vertices retroactively,
-	// as we are iterating our way through the faces.
-	Vec2     tmp_texture_uvs[8000];
-	uint32_t tmp_texture_uvs_len = 0;
-
-	// Note that tmp_face_elements do not correspond with "f" records, but rather with one of the
-	// elements in those records.
-	struct 
+	struct stat file_stat;
+	if(fstat(file, &file_stat) == -1)
 	{
-		uint32_t vertex_index;
-		uint32_t texture_uv_index;
-	} tmp_face_elements[32000];
-	uint32_t tmp_face_elements_len = 0;
+		panic();
+	}
 
-	data->vertices_len = 0;
-	while(true)
+	data->mapping_size = file_stat.st_size;
+	data->mapping      = mmap(0, data->mapping_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+	if(data->mapping == MAP_FAILED)
 	{
-		char keyword[128];
-		int32_t res = fscanf(file, "%s", keyword);
+		panic();
+	}
+	close(file);
 
-		if(res == EOF)
-		{
-			break;
-		}
+	MeshFileHeader* header = data->mapping;
+	if(!mesh_file_header_valid(header, data->mapping_size))
+	{
+		printf("Mesh file %s is invalid or was cooked with an older mesh cooker.\n", mesh_filename);
+		panic();
+	}
 
-		if(strcmp(keyword, "v") == 0)
-		{
-			Vec3* pos = &data->vertices[data->vertices_len].position;
-			fscanf(file, "%f %f %f", &pos->x, &pos->y, &pos->z);
-			data->vertices_len++;
-		}
-		else if(strcmp(keyword, "vt") == 0)
+	data->vertices      = (MeshVertex*)((uint8_t*)data->mapping + header->vertices_offset);
+	data->vertices_len  = header->vertices_len;
+	data->indices       = (uint8_t*)data->mapping + header->indices_offset;
+	data->indices_len   = header->indices_len;
+	data->index_size    = header->index_size;
+	data->index_type    = header->index_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	data->bounds_center = (Vec3){{{ header->bounds_center[0], header->bounds_center[1], header->bounds_center[2] }}};
+	data->bounds_radius = header->bounds_radius;
+	data->content_hash  = header->content_hash;
+}
+
+void vulkan_free_mesh_data(VulkanMeshData* data)
+{
+	munmap(data->mapping, data->mapping_size);
+	*data = (VulkanMeshData){};
+}
+
+// Resolves a mesh asset path to an index into ctx->allocated_meshes, loading the mesh into
+// mesh_datas[index] only if neither the path nor the file's contents have been seen before.
+// Returned indices are handed out in order, so the caller uploads mesh_datas[0..ctx->meshes_len).
+uint32_t vulkan_register_mesh(VulkanContext* ctx, char* path, VulkanMeshData* mesh_datas)
+{
+	for(uint32_t entry_index = 0; entry_index < ctx->mesh_registry_len; entry_index++)
+	{
+		if(strcmp(ctx->mesh_registry[entry_index].path, path) == 0)
 		{
-			Vec2* tmp_texture_uv = &tmp_texture_uvs[tmp_texture_uvs_len];
-			fscanf(file, "%f %f", &tmp_texture_uv->x, &tmp_texture_uv->y);
-			tmp_texture_uv->y = 1 - tmp_texture_uv->y;
-			tmp_texture_uvs_len++;
+			return ctx->mesh_registry[entry_index].mesh_index;
 		}
-		else if(strcmp(keyword, "f") == 0)
+	}
+
+	if(ctx->meshes_len >= MESHES_COUNT || ctx->mesh_registry_len >= MESH_ASSETS_LEN)
+	{
+		panic();
+	}
+
+	VulkanMeshData* data = &mesh_datas[ctx->meshes_len];
+	vulkan_load_mesh(data, path);
+	uint64_t content_hash = data->content_hash;
+
+	// A different path may still hold the same cooked data, e.g. a copied file.
+	// CONSIDER - Compare the blobs too rather than trusting a 64 bit hash to be collision free.
+	uint32_t mesh_index = ctx->meshes_len;
+	for(uint32_t entry_index = 0; entry_index < ctx->mesh_registry_len; entry_index++)
+	{
+		if(ctx->mesh_registry[entry_index].content_hash == content_hash)
 		{
-			int32_t throwaways[3];
-			int32_t values_len = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", 
-				&tmp_face_elements[tmp_face_elements_len + 0].vertex_index, 
-				&tmp_face_elements[tmp_face_elements_len + 0].texture_uv_index, 
-				&throwaways[0], 
-				&tmp_face_elements[tmp_face_elements_len + 1].vertex_index, 
-				&tmp_face_elements[tmp_face_elements_len + 1].texture_uv_index, 
-				&throwaways[1], 
-				&tmp_face_elements[tmp_face_elements_len + 2].vertex_index, 
-				&tmp_face_elements[tmp_face_elements_len + 2].texture_uv_index, 
-				&throwaways[2]);
-
-			if(values_len != 9)
-			{
-				panic();
-			}
-			tmp_face_elements_len += 3;
+			mesh_index = ctx->mesh_registry[entry_index].mesh_index;
+			vulkan_free_mesh_data(data);
+			break;
 		}
 	}
-	fclose(file);
 
-	data->indices_len  = 0;
-	for(uint32_t element_index = 0; element_index < tmp_face_elements_len; element_index++)
+	if(mesh_index == ctx->meshes_len)
 	{
-		uint32_t index = tmp_face_elements[element_index].vertex_index - 1;
-		data->indices[element_index] = index;
-		data->vertices[index].texture_uv = tmp_texture_uvs[tmp_face_elements[element_index].texture_uv_index - 1];
-
-		data->indices_len++;
+		ctx->meshes_len++;
 	}
+
+	ctx->mesh_registry[ctx->mesh_registry_len++] = (VulkanMeshRegistryEntry)
+	{
+		.path         = path,
+		.content_hash = content_hash,
+		.mesh_index   = mesh_index
+	};
+
+	return mesh_index;
 }
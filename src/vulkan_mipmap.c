@@ -0,0 +1,102 @@
+// Fills in mip levels 1 and up of an image from level 0, by repeatedly blitting each level down into
+// the next. Expects every level in TRANSFER_DST_OPTIMAL with level 0 written, and leaves every level
+// in SHADER_READ_ONLY_OPTIMAL for fragment shaders.
+//
+// Each level's transition out of TRANSFER_SRC_OPTIMAL goes out in the same batch as the next level's
+// transition into it.
+//
+// Blits need a graphics queue, so this can't be recorded on a transfer only queue.
+void vulkan_generate_mipmaps(
+	VkCommandBuffer command_buffer,
+	VkImage         image,
+	VkExtent2D      extent,
+	uint32_t        mip_levels,
+	VkFilter        filter)
+{
+	int32_t level_width  = extent.width;
+	int32_t level_height = extent.height;
+
+	VulkanBarrierBatch barriers;
+	vulkan_begin_barrier_batch(&barriers, command_buffer);
+
+	for(uint32_t level = 1; level < mip_levels; level++)
+	{
+		vulkan_batch_image_barrier(
+			&barriers,
+			image,
+			vulkan_image_levels(VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1),
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_BLIT_BIT,
+			VK_ACCESS_2_TRANSFER_READ_BIT,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED);
+		vulkan_flush_barrier_batch(&barriers);
+
+		int32_t next_width  = level_width  > 1 ? level_width  / 2 : 1;
+		int32_t next_height = level_height > 1 ? level_height / 2 : 1;
+
+		VkImageBlit blit =
+		{
+			.srcSubresource = (VkImageSubresourceLayers)
+			{
+				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel       = level - 1,
+				.baseArrayLayer = 0,
+				.layerCount     = 1
+			},
+			.srcOffsets     = { {0, 0, 0}, {level_width, level_height, 1} },
+			.dstSubresource = (VkImageSubresourceLayers)
+			{
+				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel       = level,
+				.baseArrayLayer = 0,
+				.layerCount     = 1
+			},
+			.dstOffsets     = { {0, 0, 0}, {next_width, next_height, 1} }
+		};
+		vkCmdBlitImage(
+			command_buffer,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&blit,
+			filter);
+
+		// The source level is finished with.
+		vulkan_batch_image_barrier(
+			&barriers,
+			image,
+			vulkan_image_levels(VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1),
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_BLIT_BIT,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED);
+
+		level_width  = next_width;
+		level_height = next_height;
+	}
+
+	// The last level was only ever written to.
+	vulkan_batch_image_barrier(
+		&barriers,
+		image,
+		vulkan_image_levels(VK_IMAGE_ASPECT_COLOR_BIT, mip_levels - 1, 1),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED);
+	vulkan_flush_barrier_batch(&barriers);
+}
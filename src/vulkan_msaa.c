@@ -0,0 +1,42 @@
+// The sample count for an MSAA tier: the tier's own if the device supports it for both color and
+// depth attachments, otherwise the highest supported count below it.
+VkSampleCountFlagBits vulkan_msaa_tier_samples(VulkanContext* ctx, MsaaTier tier)
+{
+	VkSampleCountFlagBits tier_samples[MSAA_TIERS_LEN] =
+	{
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_SAMPLE_COUNT_2_BIT,
+		VK_SAMPLE_COUNT_4_BIT,
+		VK_SAMPLE_COUNT_8_BIT
+	};
+
+	VkSampleCountFlagBits samples = tier_samples[tier];
+	while(samples > VK_SAMPLE_COUNT_1_BIT && !(ctx->device_framebuffer_sample_counts & samples))
+	{
+		samples >>= 1;
+	}
+	return samples;
+}
+
+// Switches to another sample count, rebuilding the graphics pipelines and letting the render graph
+// recreate its attachments. Waits for the device to go idle, which is fine for a settings change.
+//
+// Tiers the device doesn't support have already fallen back to a lower count, so what is logged is
+// the count actually used.
+void vulkan_set_msaa_samples(VulkanContext* ctx, VkSampleCountFlagBits samples)
+{
+	if(samples == VK_SAMPLE_COUNT_1_BIT)
+	{
+		printf("MSAA: off\n");
+	}
+	else
+	{
+		printf("MSAA: %ux\n", (uint32_t)samples);
+	}
+
+	vkDeviceWaitIdle(ctx->device);
+
+	ctx->msaa_samples = samples;
+	vulkan_free_render_graph_images(ctx, &ctx->render_graph);
+	vulkan_rebuild_graphics_pipelines(ctx);
+}
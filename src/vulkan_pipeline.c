@@ -1,71 +1,56 @@
 typedef struct 
 {
-	VkDescriptorType   type;
-	VkShaderStageFlags shader_stage_flags;
-	VkDeviceSize       offset_in_host_memory;
-	VkDeviceSize       range_in_host_memory;
+	VkDescriptorType         type;
+	VkShaderStageFlags       shader_stage_flags;
+	// Bindings of more than one descriptor are arrays, which are only supported for image types.
+	uint32_t                 descriptors_len;
+	// Bindings which are PARTIALLY_BOUND are left unwritten, and filled in later by whoever owns
+	// what they point at. Any binding which is UPDATE_AFTER_BIND puts the whole set in an update
+	// after bind pool.
+	VkDescriptorBindingFlags binding_flags;
+
+	// Only used with buffer descriptor types. Buffers are split into one slice per frame in flight,
+	// frame_stride bytes apart, and the offset is relative to the start of each slice.
+	VkBuffer                 buffer;
+	VkDeviceSize             frame_stride;
+	VkDeviceSize             offset_in_buffer;
+	VkDeviceSize             range_in_buffer;
 } VulkanDescriptorSetConfig;
 
+// Push constant ranges must not overlap for the same stage, and the whole block has to fit in
+// maxPushConstantsSize, which is at least 128 bytes.
+typedef struct
+{
+	VkShaderStageFlags shader_stage_flags;
+	uint32_t           offset;
+	uint32_t           size;
+} VulkanPushConstantConfig;
+
 typedef struct
 {
 	VkFormat format;
 	uint32_t offset_in_vertex_data;
 } VulkanVertexInputAttributeConfig;
 
-VkShaderModule vulkan_create_shader_module(VulkanContext* ctx, char* filename)
-{
-	FILE* file = fopen(filename, "r");
-	if(!file)
-	{
-		printf("Failed to open file: %s\n", filename);
-		panic();
-	}
-	fseek(file, 0, SEEK_END);
-	uint32_t fsize = ftell(file);
-	fseek(file, 0, SEEK_SET);
-	char src[fsize];
-
-	char c;
-	uint32_t i = 0;
-	while((c = fgetc(file)) != EOF)
-	{
-		src[i] = c;
-		i++;
-	}
-	fclose(file);
-	
-	VkShaderModuleCreateInfo shader_module_create_info = 
-	{
-		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.pNext    = 0,
-		.flags    = 0,
-		.codeSize = fsize,
-		.pCode    = (uint32_t*)src
-	};
-
-	VkShaderModule module;
-	vk_verify(vkCreateShaderModule(ctx->device, &shader_module_create_info, 0, &module));
-	
-	return module;
-}
-
-void vulkan_create_graphics_pipeline(
-	VulkanContext*                    ctx,
-	VulkanPipeline*                   pipeline,
-	char*                             vertex_shader_filename,
-	char*                             fragment_shader_filename,
-	VulkanDescriptorSetConfig*        descriptor_set_configs,
-	uint8_t                           descriptor_sets_len,
-	VulkanVertexInputAttributeConfig* vertex_input_attribute_configs,
-	uint8_t                           vertex_input_attributes_len,
-	size_t                            vertex_data_stride)
+void vulkan_create_pipeline_descriptors(
+	VulkanContext*             ctx,
+	VulkanPipeline*            pipeline,
+	VulkanDescriptorSetConfig* descriptor_set_configs,
+	uint8_t                    descriptor_sets_len)
 {
 	// Define descriptor info.
+	//
+	// Bindings are identical across frames in flight, but buffer descriptors point at each frame's
+	// own slice of their buffer, so we write one set of descriptors per frame.
 	VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[descriptor_sets_len];
+	VkDescriptorBindingFlags     descriptor_binding_flags      [descriptor_sets_len];
 	VkDescriptorPoolSize         descriptor_pool_sizes         [descriptor_sets_len];
-	VkWriteDescriptorSet         write_descriptor_sets         [descriptor_sets_len];
-	VkDescriptorBufferInfo       descriptor_buffer_infos       [descriptor_sets_len];
+	VkWriteDescriptorSet         write_descriptor_sets         [descriptor_sets_len * FRAMES_IN_FLIGHT_COUNT];
+	VkDescriptorBufferInfo       descriptor_buffer_infos       [descriptor_sets_len * FRAMES_IN_FLIGHT_COUNT];
 	VkDescriptorImageInfo        descriptor_image_infos        [descriptor_sets_len];
+	uint8_t                      write_frame_indices           [descriptor_sets_len * FRAMES_IN_FLIGHT_COUNT];
+	uint32_t                     write_descriptor_sets_len = 0;
+	bool                         update_after_bind         = false;
 
 	for(uint8_t binding = 0; binding < descriptor_sets_len; binding++)
 	{
@@ -75,55 +60,79 @@ void vulkan_create_graphics_pipeline(
 		{
 			.binding            = binding,
 			.descriptorType     = config->type,
-			.descriptorCount    = 1,
+			.descriptorCount    = config->descriptors_len,
 			.stageFlags         = config->shader_stage_flags,
 			.pImmutableSamplers = 0
 		};
+		descriptor_binding_flags[binding] = config->binding_flags;
+
+		if(config->binding_flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+		{
+			update_after_bind = true;
+		}
 
 		descriptor_pool_sizes[binding] = (VkDescriptorPoolSize)
 		{
 			.type            = config->type,
-			.descriptorCount = 1
+			.descriptorCount = config->descriptors_len * FRAMES_IN_FLIGHT_COUNT
 		};
 
-		// Only used with uniform buffer or uniform buffer dynamic descriptor types.
-		descriptor_buffer_infos[binding] = (VkDescriptorBufferInfo)
+		if(config->binding_flags & VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT)
 		{
-			.buffer = ctx->host_mapped_buffer.buffer,
-			.offset = config->offset_in_host_memory,
-			.range  = config->range_in_host_memory
-		};
+			continue;
+		}
 
 		// Only used with image sampler descriptor type.
 		descriptor_image_infos[binding] = (VkDescriptorImageInfo)
 		{
 			.sampler     = ctx->texture_sampler,
-			// TODO - This is dependant on having only one texture, of course.
-			.imageView   = ctx->texture_images[0].view,
+			// Image bindings which are written up front sample the placeholder. Bindings which are to
+			// sample streamed textures should be PARTIALLY_BOUND instead.
+			.imageView   = ctx->textures[VULKAN_PLACEHOLDER_TEXTURE].image.view,
 			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 		};
 
-		write_descriptor_sets[binding] = (VkWriteDescriptorSet)
+		for(uint8_t frame_index = 0; frame_index < FRAMES_IN_FLIGHT_COUNT; frame_index++)
 		{
-			.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.pNext            = 0,
-			.dstSet           = 0, // set later
-			.dstBinding       = binding,
-			.dstArrayElement  = 0,
-			.descriptorCount  = 1,
-			.descriptorType   = config->type,
-			.pImageInfo       = &descriptor_image_infos[binding],
-			.pBufferInfo      = &descriptor_buffer_infos[binding],
-			.pTexelBufferView = 0
-		};
+			uint32_t write_index = write_descriptor_sets_len++;
+			write_frame_indices[write_index] = frame_index;
+
+			// Only used with uniform or storage buffer descriptor types.
+			descriptor_buffer_infos[write_index] = (VkDescriptorBufferInfo)
+			{
+				.buffer = config->buffer,
+				.offset = config->offset_in_buffer + frame_index * config->frame_stride,
+				.range  = config->range_in_buffer
+			};
+
+			write_descriptor_sets[write_index] = (VkWriteDescriptorSet)
+			{
+				.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext            = 0,
+				.dstSet           = 0, // set later
+				.dstBinding       = binding,
+				.dstArrayElement  = 0,
+				.descriptorCount  = 1,
+				.descriptorType   = config->type,
+				.pImageInfo       = &descriptor_image_infos[binding],
+				.pBufferInfo      = &descriptor_buffer_infos[write_index],
+				.pTexelBufferView = 0
+			};
+		}
 	}
 
 	// Create descriptors resources.
 	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info = 
 	{
 		.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext        = 0,
-		.flags        = 0,
+		.pNext        = &(VkDescriptorSetLayoutBindingFlagsCreateInfo)
+		{
+			.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.pNext         = 0,
+			.bindingCount  = descriptor_sets_len,
+			.pBindingFlags = descriptor_binding_flags
+		},
+		.flags        = update_after_bind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0,
 		.bindingCount = descriptor_sets_len,
 		.pBindings    = descriptor_set_layout_bindings
 	};
@@ -133,46 +142,46 @@ void vulkan_create_graphics_pipeline(
 	{
 		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 		.pNext         = 0,
-		.flags         = 0,
+		.flags         = update_after_bind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0,
 		.poolSizeCount = descriptor_sets_len,
 		.pPoolSizes    = descriptor_pool_sizes,
-		.maxSets       = 1
+		.maxSets       = FRAMES_IN_FLIGHT_COUNT
 	};
 	vk_verify(vkCreateDescriptorPool(ctx->device, &descriptor_pool_create_info, 0, &pipeline->descriptor_pool));
 
+	VkDescriptorSetLayout descriptor_set_layouts[FRAMES_IN_FLIGHT_COUNT];
+	for(uint8_t frame_index = 0; frame_index < FRAMES_IN_FLIGHT_COUNT; frame_index++)
+	{
+		descriptor_set_layouts[frame_index] = pipeline->descriptor_set_layout;
+	}
+
 	VkDescriptorSetAllocateInfo descriptor_set_allocate_info = 
 	{
 		.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.pNext              = 0,
 		.descriptorPool     = pipeline->descriptor_pool,
-		.descriptorSetCount = 1,
-		.pSetLayouts        = &pipeline->descriptor_set_layout
+		.descriptorSetCount = FRAMES_IN_FLIGHT_COUNT,
+		.pSetLayouts        = descriptor_set_layouts
 	};
-	vk_verify(vkAllocateDescriptorSets(ctx->device, &descriptor_set_allocate_info, &pipeline->descriptor_set));
+	vk_verify(vkAllocateDescriptorSets(ctx->device, &descriptor_set_allocate_info, pipeline->descriptor_sets));
 
-	for(uint8_t binding = 0; binding < descriptor_sets_len; binding++)
+	for(uint32_t write_index = 0; write_index < write_descriptor_sets_len; write_index++)
 	{
-		write_descriptor_sets[binding].dstSet = pipeline->descriptor_set;
+		write_descriptor_sets[write_index].dstSet = pipeline->descriptor_sets[write_frame_indices[write_index]];
 	}
 
-	vkUpdateDescriptorSets(ctx->device, descriptor_sets_len, write_descriptor_sets, 0, 0);
+	vkUpdateDescriptorSets(ctx->device, write_descriptor_sets_len, write_descriptor_sets, 0, 0);
+}
 
-	// Define vertex input attribute descriptions.
-	VkVertexInputAttributeDescription vertex_input_attribute_descriptions[vertex_input_attributes_len];
-	for(uint8_t location = 0; location < vertex_input_attributes_len; location++)
-	{
-		vertex_input_attribute_descriptions[location] = (VkVertexInputAttributeDescription)
-		{
-			.binding  = 0,
-			.location = location,
-			.format   = vertex_input_attribute_configs[location].format,
-			.offset   = vertex_input_attribute_configs[location].offset_in_vertex_data
-		};
-	}
+// Compiles the pipeline a graphics job describes. Called from pipeline workers, so this must only
+// read the job and state which doesn't change after initialization.
+//
+// Jobs without a fragment shader are depth only. They keep the color attachment so that they can
+// be drawn within the same rendering as everything else, but never write to it.
+VkPipeline vulkan_compile_graphics_pipeline(VulkanContext* ctx, VulkanPipelineJob* job)
+{
+	bool depth_only = job->fragment_shader == 0;
 
-	// Compile shaders.
-	VkShaderModule vertex_shader   = vulkan_create_shader_module(ctx, vertex_shader_filename);
-	VkShaderModule fragment_shader = vulkan_create_shader_module(ctx, fragment_shader_filename);
 	VkPipelineShaderStageCreateInfo shader_stage_create_infos[2] =
 	{
 		{
@@ -180,7 +189,7 @@ void vulkan_create_graphics_pipeline(
 			.pNext               = 0,
 			.flags               = 0,
 			.stage               = VK_SHADER_STAGE_VERTEX_BIT,
-			.module              = vertex_shader,
+			.module              = job->vertex_shader,
 			.pName               = "main",
 			.pSpecializationInfo = 0,
 		},
@@ -189,7 +198,7 @@ void vulkan_create_graphics_pipeline(
 			.pNext               = 0,
 			.flags               = 0,
 			.stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.module              = fragment_shader,
+			.module              = job->fragment_shader,
 			.pName               = "main",
 			.pSpecializationInfo = 0,
 		}
@@ -198,19 +207,6 @@ void vulkan_create_graphics_pipeline(
 	// Define dynamic states.
 	const VkDynamicState dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
-	// Create pipeline layout.
-	VkPipelineLayoutCreateInfo pipeline_layout_create_info = 
-	{
-		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.pNext                  = 0,
-		.flags                  = 0,
-		.setLayoutCount         = 1,
-		.pSetLayouts            = &pipeline->descriptor_set_layout,
-		.pushConstantRangeCount = 0,
-		.pPushConstantRanges    = 0
-	};
-	vk_verify(vkCreatePipelineLayout(ctx->device, &pipeline_layout_create_info, 0, &pipeline->layout));
-
 	// Create graphics pipeline.
 	VkGraphicsPipelineCreateInfo graphics_pipeline_create_info = 
 	{
@@ -221,12 +217,12 @@ void vulkan_create_graphics_pipeline(
 			.pNext                   = 0,
 			.viewMask                = 0,
 			.colorAttachmentCount    = 1,
-			.pColorAttachmentFormats = &ctx->surface_format.format,
+			.pColorAttachmentFormats = &job->color_format,
 			.depthAttachmentFormat   = VK_FORMAT_D32_SFLOAT,
 			.stencilAttachmentFormat = 0
 		},
 		.flags               = 0,
-		.stageCount          = 2,
+		.stageCount          = depth_only ? 1 : 2,
 		.pStages             = shader_stage_create_infos,
 		.pVertexInputState   = &(VkPipelineVertexInputStateCreateInfo)
 		{
@@ -237,11 +233,11 @@ void vulkan_create_graphics_pipeline(
 			.pVertexBindingDescriptions      = &(VkVertexInputBindingDescription)
 			{
 				.binding   = 0,
-				.stride    = vertex_data_stride,
+				.stride    = job->vertex_data_stride,
 				.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
 			},
-			.vertexAttributeDescriptionCount = vertex_input_attributes_len,
-			.pVertexAttributeDescriptions    = vertex_input_attribute_descriptions
+			.vertexAttributeDescriptionCount = job->vertex_input_attributes_len,
+			.pVertexAttributeDescriptions    = job->vertex_input_attribute_descriptions
 		},
 		.pInputAssemblyState = &(VkPipelineInputAssemblyStateCreateInfo)
 		{
@@ -284,7 +280,7 @@ void vulkan_create_graphics_pipeline(
 			.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
 			.pNext                 = 0,
 			.flags                 = 0,
-			.rasterizationSamples  = ctx->device_framebuffer_sample_counts,
+			.rasterizationSamples  = job->samples,
 			.sampleShadingEnable   = VK_FALSE,
 			.minSampleShading      = VK_FALSE,
 			.pSampleMask           = 0,
@@ -297,8 +293,8 @@ void vulkan_create_graphics_pipeline(
 			.pNext                 = 0,
 			.flags                 = 0,
 			.depthTestEnable       = VK_TRUE,
-			.depthWriteEnable      = VK_TRUE,
-			.depthCompareOp        = VK_COMPARE_OP_LESS,
+			.depthWriteEnable      = job->depth_write ? VK_TRUE : VK_FALSE,
+			.depthCompareOp        = job->depth_compare_op,
 			.depthBoundsTestEnable = VK_FALSE,
 			.stencilTestEnable     = VK_FALSE,
 			.front                 = {},
@@ -323,7 +319,7 @@ void vulkan_create_graphics_pipeline(
 				.srcAlphaBlendFactor = 0,
 				.dstAlphaBlendFactor = 0,
 				.alphaBlendOp        = 0,
-				.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+				.colorWriteMask      = depth_only ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
 			},
 			.blendConstants    = { 0, 0, 0, 0 }
 		},
@@ -335,16 +331,40 @@ void vulkan_create_graphics_pipeline(
 			.dynamicStateCount = 2,
 			.pDynamicStates    = dynamic_states
 		},
-		.layout              = pipeline->layout,
+		.layout              = job->pipeline->layout,
 		.renderPass          = 0,
 		.subpass             = 0,
 		.basePipelineHandle  = 0,
 		.basePipelineIndex   = 0,
 	};
 
-	vk_verify(vkCreateGraphicsPipelines(ctx->device, 0, 1, &graphics_pipeline_create_info, 0, &pipeline->pipeline));
+	VkPipeline pipeline;
+	vk_verify(vkCreateGraphicsPipelines(ctx->device, ctx->pipeline_cache, 1, &graphics_pipeline_create_info, 0, &pipeline));
+	return pipeline;
+}
 
-	// Cleanup shader modules.
-	vkDestroyShaderModule(ctx->device, vertex_shader,   0);
-	vkDestroyShaderModule(ctx->device, fragment_shader, 0);
+VkPipeline vulkan_compile_compute_pipeline(VulkanContext* ctx, VulkanPipelineJob* job)
+{
+	VkComputePipelineCreateInfo compute_pipeline_create_info = 
+	{
+		.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext              = 0,
+		.flags              = 0,
+		.stage              = (VkPipelineShaderStageCreateInfo)
+		{
+			.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext               = 0,
+			.flags               = 0,
+			.stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module              = job->compute_shader,
+			.pName               = "main",
+			.pSpecializationInfo = 0,
+		},
+		.layout             = job->pipeline->layout,
+		.basePipelineHandle = 0,
+		.basePipelineIndex  = 0
+	};
+	VkPipeline pipeline;
+	vk_verify(vkCreateComputePipelines(ctx->device, ctx->pipeline_cache, 1, &compute_pipeline_create_info, 0, &pipeline));
+	return pipeline;
 }
@@ -0,0 +1,340 @@
+// Pipeline compilation runs on a pool of worker threads, one per core up to
+// VULKAN_PIPELINE_WORKERS_MAX, all compiling through the shared pipeline cache.
+//
+// vulkan_create_graphics_pipeline and vulkan_create_compute_pipeline set up everything a pipeline's
+// users bind on the calling thread (descriptors and layout) and queue the pipeline itself, so
+// initialization doesn't wait on the driver's shader compiler. Draws then go through
+// vulkan_pipeline_for_draw, which falls back to the placeholder until the real pipeline is built.
+
+void* vulkan_pipeline_worker(void* argument)
+{
+	VulkanContext*         ctx     = argument;
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	while(true)
+	{
+		pthread_mutex_lock(&builder->mutex);
+		while(builder->queue_len == 0)
+		{
+			pthread_cond_wait(&builder->queued_condition, &builder->mutex);
+		}
+
+		VulkanPipelineJob job = builder->queue[builder->queue_first];
+		builder->queue_first = (builder->queue_first + 1) % VULKAN_PIPELINE_JOBS_MAX;
+		builder->queue_len--;
+		pthread_mutex_unlock(&builder->mutex);
+
+		VkPipeline pipeline = job.type == VULKAN_PIPELINE_JOB_GRAPHICS
+			? vulkan_compile_graphics_pipeline(ctx, &job)
+			: vulkan_compile_compute_pipeline(ctx, &job);
+
+		pthread_mutex_lock(&builder->mutex);
+		if(job.placeholder)
+		{
+			job.pipeline->placeholder       = pipeline;
+			job.pipeline->placeholder_built = true;
+		}
+		else
+		{
+			job.pipeline->pipeline = pipeline;
+			job.pipeline->built    = true;
+		}
+		builder->pending_len--;
+		pthread_cond_broadcast(&builder->built_condition);
+		pthread_mutex_unlock(&builder->mutex);
+	}
+
+	return 0;
+}
+
+void vulkan_initialize_pipeline_builder(VulkanContext* ctx)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+	*builder = (VulkanPipelineBuilder){};
+
+	if(pthread_mutex_init(&builder->mutex, 0) != 0
+		|| pthread_cond_init(&builder->queued_condition, 0) != 0
+		|| pthread_cond_init(&builder->built_condition, 0) != 0)
+	{
+		panic();
+	}
+
+	int64_t cores_len = sysconf(_SC_NPROCESSORS_ONLN);
+	builder->workers_len = cores_len < 1 ? 1 : (cores_len > VULKAN_PIPELINE_WORKERS_MAX ? VULKAN_PIPELINE_WORKERS_MAX : cores_len);
+	for(uint32_t worker_index = 0; worker_index < builder->workers_len; worker_index++)
+	{
+		if(pthread_create(&builder->workers[worker_index], 0, vulkan_pipeline_worker, ctx) != 0)
+		{
+			panic();
+		}
+	}
+}
+
+// Placeholders go to the front of the queue, as something has to be drawable as soon as possible.
+void vulkan_queue_pipeline_job(VulkanContext* ctx, VulkanPipelineJob* job)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	pthread_mutex_lock(&builder->mutex);
+	if(builder->queue_len == VULKAN_PIPELINE_JOBS_MAX)
+	{
+		panic();
+	}
+
+	if(job->placeholder)
+	{
+		builder->queue_first = (builder->queue_first + VULKAN_PIPELINE_JOBS_MAX - 1) % VULKAN_PIPELINE_JOBS_MAX;
+		builder->queue[builder->queue_first] = *job;
+	}
+	else
+	{
+		builder->queue[(builder->queue_first + builder->queue_len) % VULKAN_PIPELINE_JOBS_MAX] = *job;
+	}
+	builder->queue_len++;
+	builder->pending_len++;
+	builder->cache_saved = false;
+
+	pthread_cond_signal(&builder->queued_condition);
+	pthread_mutex_unlock(&builder->mutex);
+}
+
+// Only called from the main thread.
+void vulkan_remember_graphics_job(VulkanContext* ctx, VulkanPipelineJob* job)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+	if(builder->graphics_jobs_len == VULKAN_PIPELINE_JOBS_MAX)
+	{
+		panic();
+	}
+	builder->graphics_jobs[builder->graphics_jobs_len++] = *job;
+}
+
+VkPipelineLayout vulkan_create_pipeline_layout(
+	VulkanContext*            ctx,
+	VulkanPipeline*           pipeline,
+	VulkanPushConstantConfig* push_constant_configs,
+	uint8_t                   push_constant_ranges_len)
+{
+	VkPushConstantRange push_constant_ranges[push_constant_ranges_len];
+	for(uint8_t range_index = 0; range_index < push_constant_ranges_len; range_index++)
+	{
+		push_constant_ranges[range_index] = (VkPushConstantRange)
+		{
+			.stageFlags = push_constant_configs[range_index].shader_stage_flags,
+			.offset     = push_constant_configs[range_index].offset,
+			.size       = push_constant_configs[range_index].size
+		};
+	}
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info =
+	{
+		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext                  = 0,
+		.flags                  = 0,
+		.setLayoutCount         = 1,
+		.pSetLayouts            = &pipeline->descriptor_set_layout,
+		.pushConstantRangeCount = push_constant_ranges_len,
+		.pPushConstantRanges    = push_constant_ranges
+	};
+
+	VkPipelineLayout layout;
+	vk_verify(vkCreatePipelineLayout(ctx->device, &pipeline_layout_create_info, 0, &layout));
+	return layout;
+}
+
+// Queues a graphics pipeline for compilation. If placeholder_fragment_shader_filename isn't null, a
+// placeholder with that fragment shader is queued ahead of it, and draws use it in the meantime. If
+// fragment_shader_filename is null, the pipeline is depth only.
+void vulkan_create_graphics_pipeline(
+	VulkanContext*                    ctx,
+	VulkanPipeline*                   pipeline,
+	char*                             vertex_shader_filename,
+	char*                             fragment_shader_filename,
+	char*                             placeholder_fragment_shader_filename,
+	VulkanDescriptorSetConfig*        descriptor_set_configs,
+	uint8_t                           descriptor_sets_len,
+	VulkanPushConstantConfig*         push_constant_configs,
+	uint8_t                           push_constant_ranges_len,
+	VulkanVertexInputAttributeConfig* vertex_input_attribute_configs,
+	uint8_t                           vertex_input_attributes_len,
+	size_t                            vertex_data_stride,
+	VkCompareOp                       depth_compare_op,
+	bool                              depth_write)
+{
+	if(vertex_input_attributes_len > VULKAN_VERTEX_INPUT_ATTRIBUTES_MAX)
+	{
+		panic();
+	}
+
+	vulkan_create_pipeline_descriptors(ctx, pipeline, descriptor_set_configs, descriptor_sets_len);
+	pipeline->layout            = vulkan_create_pipeline_layout(ctx, pipeline, push_constant_configs, push_constant_ranges_len);
+	pipeline->built             = false;
+	pipeline->placeholder_built = false;
+
+	VulkanPipelineJob job =
+	{
+		.type                        = VULKAN_PIPELINE_JOB_GRAPHICS,
+		.pipeline                    = pipeline,
+		.placeholder                 = false,
+		.vertex_shader               = vulkan_get_shader_module(ctx, vertex_shader_filename),
+		.fragment_shader             = fragment_shader_filename != 0 ? vulkan_get_shader_module(ctx, fragment_shader_filename) : 0,
+		.vertex_input_attributes_len = vertex_input_attributes_len,
+		.vertex_data_stride          = vertex_data_stride,
+		.color_format                = ctx->surface_format.format,
+		.samples                     = ctx->msaa_samples,
+		.depth_compare_op            = depth_compare_op,
+		.depth_write                 = depth_write
+	};
+
+	// Define vertex input attribute descriptions.
+	for(uint8_t location = 0; location < vertex_input_attributes_len; location++)
+	{
+		job.vertex_input_attribute_descriptions[location] = (VkVertexInputAttributeDescription)
+		{
+			.binding  = 0,
+			.location = location,
+			.format   = vertex_input_attribute_configs[location].format,
+			.offset   = vertex_input_attribute_configs[location].offset_in_vertex_data
+		};
+	}
+
+	if(placeholder_fragment_shader_filename != 0)
+	{
+		VulkanPipelineJob placeholder_job = job;
+		placeholder_job.placeholder     = true;
+		placeholder_job.fragment_shader = vulkan_get_shader_module(ctx, placeholder_fragment_shader_filename);
+		vulkan_remember_graphics_job(ctx, &placeholder_job);
+		vulkan_queue_pipeline_job(ctx, &placeholder_job);
+	}
+	vulkan_remember_graphics_job(ctx, &job);
+	vulkan_queue_pipeline_job(ctx, &job);
+}
+
+// Recompiles every graphics pipeline, and its placeholder, for the current sample count. The old
+// pipelines are destroyed, so the device must be idle. As on startup, draws use the placeholders
+// until the real pipelines are built.
+void vulkan_rebuild_graphics_pipelines(VulkanContext* ctx)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	// Workers write pipelines back as they finish, so let everything in flight land first.
+	pthread_mutex_lock(&builder->mutex);
+	while(builder->pending_len > 0)
+	{
+		pthread_cond_wait(&builder->built_condition, &builder->mutex);
+	}
+
+	for(uint32_t job_index = 0; job_index < builder->graphics_jobs_len; job_index++)
+	{
+		VulkanPipelineJob* job = &builder->graphics_jobs[job_index];
+		if(job->placeholder)
+		{
+			vkDestroyPipeline(ctx->device, job->pipeline->placeholder, 0);
+			job->pipeline->placeholder       = VK_NULL_HANDLE;
+			job->pipeline->placeholder_built = false;
+		}
+		else
+		{
+			vkDestroyPipeline(ctx->device, job->pipeline->pipeline, 0);
+			job->pipeline->pipeline = VK_NULL_HANDLE;
+			job->pipeline->built    = false;
+		}
+	}
+	pthread_mutex_unlock(&builder->mutex);
+
+	for(uint32_t job_index = 0; job_index < builder->graphics_jobs_len; job_index++)
+	{
+		VulkanPipelineJob* job = &builder->graphics_jobs[job_index];
+		job->samples = ctx->msaa_samples;
+		vulkan_queue_pipeline_job(ctx, job);
+	}
+}
+
+void vulkan_create_compute_pipeline(
+	VulkanContext*             ctx,
+	VulkanPipeline*            pipeline,
+	char*                      compute_shader_filename,
+	VulkanDescriptorSetConfig* descriptor_set_configs,
+	uint8_t                    descriptor_sets_len,
+	VulkanPushConstantConfig*  push_constant_configs,
+	uint8_t                    push_constant_ranges_len)
+{
+	vulkan_create_pipeline_descriptors(ctx, pipeline, descriptor_set_configs, descriptor_sets_len);
+	pipeline->layout            = vulkan_create_pipeline_layout(ctx, pipeline, push_constant_configs, push_constant_ranges_len);
+	pipeline->built             = false;
+	pipeline->placeholder_built = false;
+
+	VulkanPipelineJob job =
+	{
+		.type           = VULKAN_PIPELINE_JOB_COMPUTE,
+		.pipeline       = pipeline,
+		.placeholder    = false,
+		.compute_shader = vulkan_get_shader_module(ctx, compute_shader_filename)
+	};
+	vulkan_queue_pipeline_job(ctx, &job);
+}
+
+// The pipeline to draw with: the real one once it is built, otherwise the placeholder. Blocks only
+// if neither is built yet, or if there is no placeholder.
+VkPipeline vulkan_pipeline_for_draw(VulkanContext* ctx, VulkanPipeline* pipeline)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	pthread_mutex_lock(&builder->mutex);
+	while(!pipeline->built && !pipeline->placeholder_built)
+	{
+		pthread_cond_wait(&builder->built_condition, &builder->mutex);
+	}
+	VkPipeline result = pipeline->built ? pipeline->pipeline : pipeline->placeholder;
+	pthread_mutex_unlock(&builder->mutex);
+
+	return result;
+}
+
+// Whether the real pipeline is built, for passes which are optional and can be skipped until then.
+bool vulkan_pipeline_built(VulkanContext* ctx, VulkanPipeline* pipeline)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	pthread_mutex_lock(&builder->mutex);
+	bool built = pipeline->built;
+	pthread_mutex_unlock(&builder->mutex);
+
+	return built;
+}
+
+// For pipelines which have no stand in, such as compute passes whose results later passes depend on.
+VkPipeline vulkan_wait_for_pipeline(VulkanContext* ctx, VulkanPipeline* pipeline)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+
+	pthread_mutex_lock(&builder->mutex);
+	while(!pipeline->built)
+	{
+		pthread_cond_wait(&builder->built_condition, &builder->mutex);
+	}
+	pthread_mutex_unlock(&builder->mutex);
+
+	return pipeline->pipeline;
+}
+
+// Called once per frame. Saves the pipeline cache once every queued pipeline has been built, so
+// that the next run starts warm.
+void vulkan_update_pipeline_builder(VulkanContext* ctx)
+{
+	VulkanPipelineBuilder* builder = &ctx->pipeline_builder;
+	if(builder->cache_saved)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&builder->mutex);
+	bool idle = builder->pending_len == 0;
+	pthread_mutex_unlock(&builder->mutex);
+
+	if(idle)
+	{
+		vulkan_save_pipeline_cache(ctx);
+		builder->cache_saved = true;
+	}
+}
@@ -0,0 +1,90 @@
+// Pipelines are compiled through a single VkPipelineCache which persists across runs in
+// VULKAN_PIPELINE_CACHE_PATH, so that a warm start skips shader compilation in the driver.
+//
+// Drivers are meant to reject incompatible cache data themselves, but some have been known to
+// crash on it instead, so the header is checked against the device before the data is handed over.
+
+bool vulkan_pipeline_cache_data_valid(VulkanContext* ctx, void* data, size_t size)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(ctx->physical_device, &properties);
+
+	VkPipelineCacheHeaderVersionOne* header = data;
+	return size >= sizeof(VkPipelineCacheHeaderVersionOne)
+		&& header->headerSize >= sizeof(VkPipelineCacheHeaderVersionOne)
+		&& header->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header->vendorID == properties.vendorID
+		&& header->deviceID == properties.deviceID
+		&& memcmp(header->pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Starts out empty if there is no cache file yet, or if it was written for another device or
+// driver.
+void vulkan_create_pipeline_cache(VulkanContext* ctx)
+{
+	void*  data = 0;
+	size_t size = 0;
+
+	FILE* file = fopen(VULKAN_PIPELINE_CACHE_PATH, "rb");
+	if(file)
+	{
+		fseek(file, 0, SEEK_END);
+		size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		data = malloc(size);
+		if(data == 0 || fread(data, 1, size, file) != size || !vulkan_pipeline_cache_data_valid(ctx, data, size))
+		{
+			printf("Discarding stale pipeline cache: %s\n", VULKAN_PIPELINE_CACHE_PATH);
+			size = 0;
+		}
+		fclose(file);
+	}
+
+	VkPipelineCacheCreateInfo pipeline_cache_create_info =
+	{
+		.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext           = 0,
+		.flags           = 0,
+		.initialDataSize = size,
+		.pInitialData    = size > 0 ? data : 0
+	};
+	vk_verify(vkCreatePipelineCache(ctx->device, &pipeline_cache_create_info, 0, &ctx->pipeline_cache));
+
+	free(data);
+}
+
+// Writes the cache out with everything compiled so far. The file is replaced by renaming over it,
+// so an interrupted save can't leave a truncated cache behind.
+void vulkan_save_pipeline_cache(VulkanContext* ctx)
+{
+	size_t size;
+	vk_verify(vkGetPipelineCacheData(ctx->device, ctx->pipeline_cache, &size, 0));
+
+	void* data = malloc(size);
+	if(data == 0)
+	{
+		panic();
+	}
+	vk_verify(vkGetPipelineCacheData(ctx->device, ctx->pipeline_cache, &size, data));
+
+	char temporary_path[] = VULKAN_PIPELINE_CACHE_PATH ".tmp";
+	FILE* file = fopen(temporary_path, "wb");
+	if(!file)
+	{
+		// Not fatal, the next run just compiles from scratch.
+		printf("Failed to open file: %s\n", temporary_path);
+		free(data);
+		return;
+	}
+
+	bool written = fwrite(data, 1, size, file) == size;
+	written = fclose(file) == 0 && written;
+	if(!written || rename(temporary_path, VULKAN_PIPELINE_CACHE_PATH) != 0)
+	{
+		printf("Failed to save pipeline cache: %s\n", VULKAN_PIPELINE_CACHE_PATH);
+		remove(temporary_path);
+	}
+
+	free(data);
+}
@@ -0,0 +1,594 @@
+// A frame graph. Each frame, passes are declared along with every resource they use and how, and
+// the graph records them in order with the barriers between them worked out from those uses:
+// - Passes whose writes never reach an output of the graph, or a pass reading them, are culled.
+// - Transient images are created by the graph, and those whose lifetimes don't overlap share one
+//   image.
+// - The barriers before each pass go out in a single VulkanBarrierBatch flush, and are only
+//   emitted where there is a hazard or a layout transition.
+//
+// Attachment usages assume the pass clears or fully overwrites the attachment, so a transient's
+// contents are discarded at the start of its lifetime. Transients only ever used as attachments are
+// created as transient attachments, and passes should store them with vulkan_render_graph_store_op
+// so that their contents never have to leave tile memory once nothing reads them.
+//
+// CONSIDER - Transients of different descriptions could alias the same memory rather than only the
+// same image, which the allocator would need to support.
+
+#define VULKAN_RESOURCE_USAGE_WRITE_BITS ( \
+	VULKAN_RESOURCE_USAGE_TRANSFER_WRITE_BIT \
+	| VULKAN_RESOURCE_USAGE_COMPUTE_WRITE_BIT \
+	| VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT \
+	| VULKAN_RESOURCE_USAGE_DEPTH_ATTACHMENT_BIT)
+#define VULKAN_RESOURCE_USAGE_READ_BITS ( \
+	VULKAN_RESOURCE_USAGE_COMPUTE_READ_BIT \
+	| VULKAN_RESOURCE_USAGE_INDIRECT_READ_BIT \
+	| VULKAN_RESOURCE_USAGE_VERTEX_SHADER_READ_BIT)
+
+#define VULKAN_ACCESS_2_WRITE_BITS ( \
+	VK_ACCESS_2_TRANSFER_WRITE_BIT \
+	| VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT \
+	| VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT \
+	| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)
+
+// The stages, accesses and image layout of a usage. Usages combined on one image which want
+// different layouts get GENERAL.
+void vulkan_resource_usage_masks(
+	VulkanResourceUsageFlags usage,
+	VkPipelineStageFlags2*   stages,
+	VkAccessFlags2*          access,
+	VkImageLayout*           layout)
+{
+	*stages = VK_PIPELINE_STAGE_2_NONE;
+	*access = VK_ACCESS_2_NONE;
+	*layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	for(uint32_t bit = 1; bit <= usage; bit <<= 1)
+	{
+		VkPipelineStageFlags2 bit_stages;
+		VkAccessFlags2        bit_access;
+		VkImageLayout         bit_layout;
+		switch(usage & bit)
+		{
+			case 0:
+				continue;
+			case VULKAN_RESOURCE_USAGE_TRANSFER_WRITE_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_COPY_BIT;
+				bit_access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_COMPUTE_READ_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+				bit_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_GENERAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_COMPUTE_WRITE_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+				bit_access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_GENERAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_INDIRECT_READ_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+				bit_access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				break;
+			case VULKAN_RESOURCE_USAGE_VERTEX_SHADER_READ_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+				bit_access = VK_ACCESS_2_SHADER_READ_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+				bit_access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_DEPTH_ATTACHMENT_BIT:
+				bit_stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+				bit_access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				bit_layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+				break;
+			case VULKAN_RESOURCE_USAGE_PRESENT_BIT:
+				// Presentation is ordered by the semaphore the submission signals.
+				bit_stages = VK_PIPELINE_STAGE_2_NONE;
+				bit_access = VK_ACCESS_2_NONE;
+				bit_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+				break;
+			default:
+				panic();
+		}
+
+		*stages |= bit_stages;
+		*access |= bit_access;
+		if(*layout == VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			*layout = bit_layout;
+		}
+		else if(bit_layout != VK_IMAGE_LAYOUT_UNDEFINED && bit_layout != *layout)
+		{
+			*layout = VK_IMAGE_LAYOUT_GENERAL;
+		}
+	}
+}
+
+VkImageUsageFlags vulkan_resource_usage_image_usage(VulkanResourceUsageFlags usage)
+{
+	VkImageUsageFlags image_usage = 0;
+	if(usage & VULKAN_RESOURCE_USAGE_TRANSFER_WRITE_BIT)
+	{
+		image_usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+	if(usage & (VULKAN_RESOURCE_USAGE_COMPUTE_READ_BIT | VULKAN_RESOURCE_USAGE_COMPUTE_WRITE_BIT))
+	{
+		image_usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+	}
+	if(usage & VULKAN_RESOURCE_USAGE_VERTEX_SHADER_READ_BIT)
+	{
+		image_usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	}
+	if(usage & VULKAN_RESOURCE_USAGE_COLOR_ATTACHMENT_BIT)
+	{
+		image_usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	}
+	if(usage & VULKAN_RESOURCE_USAGE_DEPTH_ATTACHMENT_BIT)
+	{
+		image_usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	}
+	return image_usage;
+}
+
+// Transient images are sized to extent, which is the swapchain extent.
+void vulkan_begin_render_graph(VulkanRenderGraph* graph, VkExtent2D extent)
+{
+	graph->extent        = extent;
+	graph->passes_len    = 0;
+	graph->resources_len = 0;
+
+	for(uint32_t image_index = 0; image_index < graph->images_len; image_index++)
+	{
+		graph->images[image_index].last_pass = -1;
+	}
+}
+
+uint32_t vulkan_render_graph_add_resource(VulkanRenderGraph* graph, VulkanRenderGraphResource* resource)
+{
+	if(graph->resources_len == VULKAN_RENDER_GRAPH_RESOURCES_MAX)
+	{
+		panic();
+	}
+
+	resource->first_pass = -1;
+	resource->last_pass  = -1;
+	graph->resources[graph->resources_len] = *resource;
+	return graph->resources_len++;
+}
+
+// Images from outside the graph start out in initial_state, and are left in final_usage after the
+// last pass.
+uint32_t vulkan_render_graph_import_image(
+	VulkanRenderGraph*       graph,
+	VkImage                  image,
+	VkImageView              view,
+	VkImageAspectFlags       aspect,
+	VulkanResourceState      initial_state,
+	VulkanResourceUsageFlags final_usage)
+{
+	return vulkan_render_graph_add_resource(graph, &(VulkanRenderGraphResource)
+	{
+		.type        = VULKAN_RENDER_GRAPH_RESOURCE_IMAGE,
+		.transient   = false,
+		.state       = initial_state,
+		.final_usage = final_usage,
+		.image       = image,
+		.view        = view,
+		.aspect      = aspect
+	});
+}
+
+// Buffers from outside the graph are expected to be idle on the device, as per frame resources are
+// once the frame's fence has been waited on.
+uint32_t vulkan_render_graph_import_buffer(
+	VulkanRenderGraph* graph,
+	VkBuffer           buffer,
+	VkDeviceSize       offset,
+	VkDeviceSize       size)
+{
+	return vulkan_render_graph_add_resource(graph, &(VulkanRenderGraphResource)
+	{
+		.type        = VULKAN_RENDER_GRAPH_RESOURCE_BUFFER,
+		.transient   = false,
+		.state       = {},
+		.final_usage = 0,
+		.buffer      = buffer,
+		.offset      = offset,
+		.size        = size
+	});
+}
+
+// The image itself is only created, or taken from an earlier frame, once the graph is executed.
+uint32_t vulkan_render_graph_create_image(
+	VulkanRenderGraph*    graph,
+	VkFormat              format,
+	VkSampleCountFlagBits samples,
+	VkImageAspectFlags    aspect)
+{
+	return vulkan_render_graph_add_resource(graph, &(VulkanRenderGraphResource)
+	{
+		.type        = VULKAN_RENDER_GRAPH_RESOURCE_IMAGE,
+		.transient   = true,
+		.final_usage = 0,
+		.aspect      = aspect,
+		.format      = format,
+		.samples     = samples
+	});
+}
+
+// Record is called with data when the graph is executed, unless the pass is culled.
+uint32_t vulkan_render_graph_add_pass(
+	VulkanRenderGraph* graph,
+	char*              name,
+	void               (*record)(VkCommandBuffer command_buffer, void* data),
+	void*              data)
+{
+	if(graph->passes_len == VULKAN_RENDER_GRAPH_PASSES_MAX)
+	{
+		panic();
+	}
+
+	graph->passes[graph->passes_len] = (VulkanRenderGraphPass)
+	{
+		.name         = name,
+		.record       = record,
+		.data         = data,
+		.accesses_len = 0,
+		.culled       = false
+	};
+	return graph->passes_len++;
+}
+
+// Declares that a pass uses a resource. Declaring the same resource twice adds to its usage.
+void vulkan_render_graph_use(
+	VulkanRenderGraph*       graph,
+	uint32_t                 pass_index,
+	uint32_t                 resource,
+	VulkanResourceUsageFlags usage)
+{
+	VulkanRenderGraphPass* pass = &graph->passes[pass_index];
+	for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+	{
+		if(pass->accesses[access_index].resource == resource)
+		{
+			pass->accesses[access_index].usage |= usage;
+			return;
+		}
+	}
+
+	if(pass->accesses_len == VULKAN_RENDER_GRAPH_PASS_ACCESSES_MAX)
+	{
+		panic();
+	}
+	pass->accesses[pass->accesses_len++] = (VulkanRenderGraphAccess){ resource, usage };
+}
+
+// Only valid for transients while the graph is being executed, which is when passes record.
+VkImageView vulkan_render_graph_image_view(VulkanRenderGraph* graph, uint32_t resource)
+{
+	return graph->resources[resource].view;
+}
+
+// The store op for an attachment of the pass being recorded: STORE if a later pass or the
+// resource's final usage needs its contents, otherwise DONT_CARE.
+VkAttachmentStoreOp vulkan_render_graph_store_op(VulkanRenderGraph* graph, uint32_t resource)
+{
+	VulkanRenderGraphResource* graph_resource = &graph->resources[resource];
+	if(graph_resource->final_usage != 0 || graph_resource->last_pass > graph->recording_pass)
+	{
+		return VK_ATTACHMENT_STORE_OP_STORE;
+	}
+	return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+}
+
+// Walks the passes backwards, keeping those which write something an output or a kept pass reads.
+//
+// CONSIDER - A write is treated as a read of whatever it doesn't overwrite, so a pass fully
+// overwriting an earlier pass's output doesn't get that pass culled.
+void vulkan_cull_render_graph(VulkanRenderGraph* graph)
+{
+	bool needed[VULKAN_RENDER_GRAPH_RESOURCES_MAX];
+	for(uint32_t resource_index = 0; resource_index < graph->resources_len; resource_index++)
+	{
+		needed[resource_index] = graph->resources[resource_index].final_usage != 0;
+	}
+
+	for(int32_t pass_index = graph->passes_len - 1; pass_index >= 0; pass_index--)
+	{
+		VulkanRenderGraphPass* pass = &graph->passes[pass_index];
+
+		pass->culled = true;
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphAccess* access = &pass->accesses[access_index];
+			if((access->usage & VULKAN_RESOURCE_USAGE_WRITE_BITS) && needed[access->resource])
+			{
+				pass->culled = false;
+			}
+		}
+
+		if(pass->culled)
+		{
+			continue;
+		}
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphAccess* access = &pass->accesses[access_index];
+			if(access->usage & VULKAN_RESOURCE_USAGE_READ_BITS)
+			{
+				needed[access->resource] = true;
+			}
+		}
+	}
+}
+
+// Finds a graph image matching the transient which is free for its whole lifetime, creating one if
+// there is none.
+void vulkan_assign_render_graph_image(VulkanContext* ctx, VulkanRenderGraph* graph, VulkanRenderGraphResource* resource)
+{
+	uint32_t image_index = 0;
+	for(; image_index < graph->images_len; image_index++)
+	{
+		VulkanRenderGraphImage* image = &graph->images[image_index];
+		if(image->format == resource->format
+			&& image->extent.width == graph->extent.width
+			&& image->extent.height == graph->extent.height
+			&& image->samples == resource->samples
+			&& image->usage == resource->image_usage
+			&& image->aspect == resource->aspect
+			&& image->last_pass < resource->first_pass)
+		{
+			break;
+		}
+	}
+
+	if(image_index == graph->images_len)
+	{
+		if(graph->images_len == VULKAN_RENDER_GRAPH_IMAGES_MAX)
+		{
+			panic();
+		}
+		graph->images_len++;
+
+		VulkanRenderGraphImage* image = &graph->images[image_index];
+		*image = (VulkanRenderGraphImage)
+		{
+			.format  = resource->format,
+			.extent  = graph->extent,
+			.samples = resource->samples,
+			.usage   = resource->image_usage,
+			.aspect  = resource->aspect,
+			.state   = { .layout = VK_IMAGE_LAYOUT_UNDEFINED }
+		};
+		vulkan_allocate_image(ctx, &image->image, image->extent, 1, image->format, image->samples, image->usage);
+		vulkan_create_image_view(ctx, &image->image.image, &image->image.view, image->format, image->aspect);
+	}
+
+	VulkanRenderGraphImage* image = &graph->images[image_index];
+	image->last_pass         = resource->last_pass;
+	resource->physical_image = image_index;
+	resource->image          = image->image.image;
+	resource->view           = image->image.view;
+}
+
+// Moves a resource to a new usage, adding a barrier to barriers if the usage has to wait on
+// earlier ones. Reads following reads only wait if they come from stages which haven't yet seen the
+// last write. If discard is set, the previous contents of an image are not kept.
+void vulkan_render_graph_transition(
+	VulkanRenderGraphResource* resource,
+	VulkanResourceUsageFlags   usage,
+	bool                       discard,
+	VulkanBarrierBatch*        barriers)
+{
+	VkPipelineStageFlags2 stages;
+	VkAccessFlags2        access;
+	VkImageLayout         layout;
+	vulkan_resource_usage_masks(usage, &stages, &access, &layout);
+
+	VulkanResourceState* state  = &resource->state;
+	VkAccessFlags2       writes = access & VULKAN_ACCESS_2_WRITE_BITS;
+	VkAccessFlags2       reads  = access & ~VULKAN_ACCESS_2_WRITE_BITS;
+	bool layout_change = resource->type == VULKAN_RENDER_GRAPH_RESOURCE_IMAGE && layout != state->layout;
+
+	VkPipelineStageFlags2 src_stages;
+	VkAccessFlags2        src_access;
+	VkImageLayout         old_layout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state->layout;
+	bool                  barrier;
+
+	// Writes and layout transitions wait on every earlier use. The transition itself counts as the
+	// last write, so later reads wait on it.
+	if(writes != 0 || layout_change)
+	{
+		src_stages = state->write_stages | state->read_stages;
+		src_access = state->write_access;
+		barrier    = src_stages != VK_PIPELINE_STAGE_2_NONE || layout_change;
+
+		*state = (VulkanResourceState)
+		{
+			.write_stages = stages,
+			.write_access = writes,
+			.read_stages  = reads != 0 ? stages : VK_PIPELINE_STAGE_2_NONE,
+			.read_access  = reads,
+			.layout       = layout
+		};
+	}
+	else
+	{
+		src_stages = state->write_stages;
+		src_access = state->write_access;
+		barrier    = src_stages != VK_PIPELINE_STAGE_2_NONE
+			&& ((stages & ~state->read_stages) != 0 || (reads & ~state->read_access) != 0);
+
+		state->read_stages |= stages;
+		state->read_access |= reads;
+	}
+
+	if(!barrier)
+	{
+		return;
+	}
+
+	if(resource->type == VULKAN_RENDER_GRAPH_RESOURCE_IMAGE)
+	{
+		vulkan_batch_image_barrier(
+			barriers,
+			resource->image,
+			vulkan_image_subresources(resource->aspect),
+			old_layout,
+			layout,
+			src_stages,
+			src_access,
+			stages,
+			access,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED);
+	}
+	else
+	{
+		vulkan_batch_buffer_barrier(
+			barriers,
+			resource->buffer,
+			resource->offset,
+			resource->size,
+			src_stages,
+			src_access,
+			stages,
+			access,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED);
+	}
+}
+
+// Culls the graph, assigns images to its transients, then records every kept pass into
+// command_buffer, followed by the transitions of imported images to their final usage.
+void vulkan_execute_render_graph(VulkanContext* ctx, VulkanRenderGraph* graph, VkCommandBuffer command_buffer)
+{
+	vulkan_cull_render_graph(graph);
+
+	for(uint32_t pass_index = 0; pass_index < graph->passes_len; pass_index++)
+	{
+		VulkanRenderGraphPass* pass = &graph->passes[pass_index];
+		if(pass->culled)
+		{
+			continue;
+		}
+
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphAccess*   access   = &pass->accesses[access_index];
+			VulkanRenderGraphResource* resource = &graph->resources[access->resource];
+			if(resource->first_pass == -1)
+			{
+				resource->first_pass = pass_index;
+			}
+			resource->last_pass    = pass_index;
+			resource->image_usage |= vulkan_resource_usage_image_usage(access->usage);
+		}
+	}
+
+	// Transients which are only attachments can live in tile memory alone.
+	VkImageUsageFlags attachment_usage = 
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	for(uint32_t resource_index = 0; resource_index < graph->resources_len; resource_index++)
+	{
+		VulkanRenderGraphResource* resource = &graph->resources[resource_index];
+		if(resource->transient && resource->image_usage != 0 && (resource->image_usage & ~attachment_usage) == 0)
+		{
+			resource->image_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+
+	// Passes are in order, so transients are assigned in order of their first pass.
+	for(uint32_t pass_index = 0; pass_index < graph->passes_len; pass_index++)
+	{
+		VulkanRenderGraphPass* pass = &graph->passes[pass_index];
+		if(pass->culled)
+		{
+			continue;
+		}
+
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphResource* resource = &graph->resources[pass->accesses[access_index].resource];
+			if(resource->transient && resource->first_pass == (int32_t)pass_index)
+			{
+				vulkan_assign_render_graph_image(ctx, graph, resource);
+			}
+		}
+	}
+
+	VulkanBarrierBatch barriers;
+	vulkan_begin_barrier_batch(&barriers, command_buffer);
+
+	for(uint32_t pass_index = 0; pass_index < graph->passes_len; pass_index++)
+	{
+		VulkanRenderGraphPass* pass = &graph->passes[pass_index];
+		if(pass->culled)
+		{
+			continue;
+		}
+
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphAccess*   access   = &pass->accesses[access_index];
+			VulkanRenderGraphResource* resource = &graph->resources[access->resource];
+
+			// A transient picks up where the last user of its image left it, which may have been an
+			// earlier transient or an earlier frame.
+			bool discard = false;
+			if(resource->transient && resource->first_pass == (int32_t)pass_index)
+			{
+				resource->state = graph->images[resource->physical_image].state;
+				discard         = (access->usage & VULKAN_RESOURCE_USAGE_READ_BITS) == 0;
+			}
+
+			vulkan_render_graph_transition(
+				resource,
+				access->usage,
+				discard,
+				&barriers);
+		}
+		vulkan_flush_barrier_batch(&barriers);
+
+		graph->recording_pass = pass_index;
+		pass->record(command_buffer, pass->data);
+
+		for(uint32_t access_index = 0; access_index < pass->accesses_len; access_index++)
+		{
+			VulkanRenderGraphResource* resource = &graph->resources[pass->accesses[access_index].resource];
+			if(resource->transient && resource->last_pass == (int32_t)pass_index)
+			{
+				graph->images[resource->physical_image].state = resource->state;
+			}
+		}
+	}
+
+	for(uint32_t resource_index = 0; resource_index < graph->resources_len; resource_index++)
+	{
+		VulkanRenderGraphResource* resource = &graph->resources[resource_index];
+		if(resource->final_usage != 0)
+		{
+			vulkan_render_graph_transition(
+				resource,
+				resource->final_usage,
+				resource->last_pass == -1,
+				&barriers);
+		}
+	}
+	vulkan_flush_barrier_batch(&barriers);
+}
+
+// Called when the attachments' sample count changes, once the device is idle.
+void vulkan_free_render_graph_images(VulkanContext* ctx, VulkanRenderGraph* graph)
+{
+	for(uint32_t image_index = 0; image_index < graph->images_len; image_index++)
+	{
+		vulkan_free_image(ctx, &graph->images[image_index].image);
+	}
+	graph->images_len = 0;
+}
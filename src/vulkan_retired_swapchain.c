@@ -0,0 +1,83 @@
+// Swapchain recreation doesn't wait for the device. Whatever the old swapchain's frames may still be
+// using, the swapchain itself, its image views and semaphores and any render graph images sized to
+// it, is retired instead, and destroyed once every frame in flight at the time has retired too.
+//
+// CONSIDER - Frames retiring doesn't strictly guarantee the presentation engine is done with the
+// old swapchain's images. VK_EXT_swapchain_maintenance1 adds present fences which would.
+
+void vulkan_destroy_retired_swapchain(VulkanContext* ctx, VulkanRetiredSwapchain* retired)
+{
+	for(uint32_t view_index = 0; view_index < retired->image_views_len; view_index++)
+	{
+		vkDestroyImageView(ctx->device, retired->image_views[view_index], 0);
+		vkDestroySemaphore(ctx->device, retired->render_finished_semaphores[view_index], 0);
+	}
+	for(uint32_t image_index = 0; image_index < retired->images_len; image_index++)
+	{
+		vulkan_free_image(ctx, &retired->images[image_index]);
+	}
+	vkDestroySwapchainKHR(ctx->device, retired->swapchain, 0);
+}
+
+// Called once per frame, after waiting on the frame's fence. Every submission up to the one which
+// last used the frame has completed by then, so anything retired FRAMES_IN_FLIGHT_COUNT submissions
+// ago is no longer in use.
+void vulkan_destroy_retired_swapchains(VulkanContext* ctx)
+{
+	uint32_t retired_swapchains_len = 0;
+	for(uint32_t retired_index = 0; retired_index < ctx->retired_swapchains_len; retired_index++)
+	{
+		VulkanRetiredSwapchain* retired = &ctx->retired_swapchains[retired_index];
+		if(ctx->frames_submitted < retired->frames_submitted + FRAMES_IN_FLIGHT_COUNT)
+		{
+			ctx->retired_swapchains[retired_swapchains_len++] = *retired;
+			continue;
+		}
+
+		vulkan_destroy_retired_swapchain(ctx, retired);
+	}
+	ctx->retired_swapchains_len = retired_swapchains_len;
+}
+
+// Retires the current swapchain with its image views and semaphores, along with the render graph's
+// images which don't match new_extent. Graph images of the new extent are kept and go on being
+// used. If too many recreations pile up, for instance while a window is being dragged to size,
+// this waits for the device and destroys everything retired so far.
+void vulkan_retire_swapchain(VulkanContext* ctx, VkExtent2D new_extent)
+{
+	if(ctx->retired_swapchains_len == VULKAN_RETIRED_SWAPCHAINS_MAX)
+	{
+		vkDeviceWaitIdle(ctx->device);
+		for(uint32_t retired_index = 0; retired_index < ctx->retired_swapchains_len; retired_index++)
+		{
+			vulkan_destroy_retired_swapchain(ctx, &ctx->retired_swapchains[retired_index]);
+		}
+		ctx->retired_swapchains_len = 0;
+	}
+
+	VulkanRetiredSwapchain* retired = &ctx->retired_swapchains[ctx->retired_swapchains_len++];
+	*retired = (VulkanRetiredSwapchain)
+	{
+		.swapchain        = ctx->swapchain,
+		.image_views_len  = ctx->swapchain_images_len,
+		.images_len       = 0,
+		.frames_submitted = ctx->frames_submitted
+	};
+	memcpy(retired->image_views, ctx->swapchain_image_views, ctx->swapchain_images_len * sizeof(VkImageView));
+	memcpy(retired->render_finished_semaphores, ctx->swapchain_render_finished_semaphores, ctx->swapchain_images_len * sizeof(VkSemaphore));
+
+	VulkanRenderGraph* graph = &ctx->render_graph;
+	uint32_t images_len = 0;
+	for(uint32_t image_index = 0; image_index < graph->images_len; image_index++)
+	{
+		VulkanRenderGraphImage* image = &graph->images[image_index];
+		if(image->extent.width == new_extent.width && image->extent.height == new_extent.height)
+		{
+			graph->images[images_len++] = *image;
+			continue;
+		}
+
+		retired->images[retired->images_len++] = image->image;
+	}
+	graph->images_len = images_len;
+}
@@ -0,0 +1,75 @@
+#define SPIRV_MAGIC 0x07230203
+
+// Reads a .spv file with a single mapping, which is page aligned and so satisfies the 4 byte
+// alignment vkCreateShaderModule expects of pCode.
+VkShaderModule vulkan_create_shader_module(VulkanContext* ctx, char* filename)
+{
+	int32_t file = open(filename, O_RDONLY);
+	if(file == -1)
+	{
+		printf("Failed to open file: %s\n", filename);
+		panic();
+	}
+
+	struct stat file_stat;
+	if(fstat(file, &file_stat) == -1)
+	{
+		panic();
+	}
+
+	size_t    code_size = file_stat.st_size;
+	uint32_t* code      = mmap(0, code_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if(code == MAP_FAILED)
+	{
+		panic();
+	}
+	close(file);
+
+	if(code_size < sizeof(uint32_t) || code_size % sizeof(uint32_t) != 0 || code[0] != SPIRV_MAGIC)
+	{
+		printf("Shader file %s is not SPIR-V.\n", filename);
+		panic();
+	}
+
+	VkShaderModuleCreateInfo shader_module_create_info =
+	{
+		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext    = 0,
+		.flags    = 0,
+		.codeSize = code_size,
+		.pCode    = code
+	};
+
+	VkShaderModule module;
+	vk_verify(vkCreateShaderModule(ctx->device, &shader_module_create_info, 0, &module));
+
+	munmap(code, code_size);
+	return module;
+}
+
+// Returns the shader module for a .spv path, creating it the first time the path is seen. Modules
+// are matched by a hash of the path first, so lookups only compare strings on a likely hit.
+VkShaderModule vulkan_get_shader_module(VulkanContext* ctx, char* filename)
+{
+	uint64_t path_hash = hash_bytes(HASH_SEED, filename, strlen(filename));
+
+	for(uint32_t module_index = 0; module_index < ctx->shader_modules_len; module_index++)
+	{
+		VulkanShaderModuleEntry* entry = &ctx->shader_modules[module_index];
+		if(entry->path_hash == path_hash && strcmp(entry->path, filename) == 0)
+		{
+			return entry->module;
+		}
+	}
+
+	if(ctx->shader_modules_len == VULKAN_SHADER_MODULES_MAX)
+	{
+		panic();
+	}
+
+	VulkanShaderModuleEntry* entry = &ctx->shader_modules[ctx->shader_modules_len++];
+	entry->path      = filename;
+	entry->path_hash = path_hash;
+	entry->module    = vulkan_create_shader_module(ctx, filename);
+	return entry->module;
+}
@@ -0,0 +1,84 @@
+void vulkan_create_staging_ring(VulkanContext* ctx, VulkanStagingRing* ring, VkDeviceSize size)
+{
+	*ring = (VulkanStagingRing){};
+	ring->size = size;
+
+	vulkan_allocate_memory_buffer(
+		ctx,
+		&ring->buffer,
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		0);
+}
+
+// Hands out size bytes of the ring, writable through the returned pointer and readable by the GPU
+// at offset in ring->buffer. Returns null if the ring doesn't have room until earlier regions are
+// reclaimed.
+//
+// Allocations never straddle the end of the buffer. If one would, the remainder is skipped and the
+// allocation starts over at the beginning.
+void* vulkan_staging_ring_allocate(VulkanStagingRing* ring, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+	if(size > ring->size)
+	{
+		printf("Upload of %lu bytes does not fit in the staging ring.\n", (unsigned long)size);
+		panic();
+	}
+
+	// A region is needed to retire whatever is allocated now.
+	if(ring->regions_len == VULKAN_STAGING_REGIONS_MAX && ring->head == ring->retired)
+	{
+		return 0;
+	}
+
+	uint64_t start = vulkan_align_up(ring->head, alignment);
+	if(start % ring->size + size > ring->size)
+	{
+		start = (start / ring->size + 1) * ring->size;
+	}
+
+	if(start + size - ring->tail > ring->size)
+	{
+		return 0;
+	}
+
+	ring->head = start + size;
+	*offset = start % ring->size;
+	return (uint8_t*)ring->buffer.allocation.mapped + *offset;
+}
+
+// Marks everything allocated since the last call as read by the submission which signals
+// timeline_value.
+void vulkan_staging_ring_retire(VulkanStagingRing* ring, uint64_t timeline_value)
+{
+	if(ring->head == ring->retired)
+	{
+		return;
+	}
+
+	if(ring->regions_len == VULKAN_STAGING_REGIONS_MAX)
+	{
+		panic();
+	}
+
+	uint32_t region_index = (ring->regions_first + ring->regions_len) % VULKAN_STAGING_REGIONS_MAX;
+	ring->regions[region_index] = (VulkanStagingRegion)
+	{
+		.end            = ring->head,
+		.timeline_value = timeline_value
+	};
+	ring->regions_len++;
+	ring->retired = ring->head;
+}
+
+// Releases the regions of every submission up to and including completed_timeline_value.
+void vulkan_staging_ring_reclaim(VulkanStagingRing* ring, uint64_t completed_timeline_value)
+{
+	while(ring->regions_len > 0 && ring->regions[ring->regions_first].timeline_value <= completed_timeline_value)
+	{
+		ring->tail          = ring->regions[ring->regions_first].end;
+		ring->regions_first = (ring->regions_first + 1) % VULKAN_STAGING_REGIONS_MAX;
+		ring->regions_len--;
+	}
+}
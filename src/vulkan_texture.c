@@ -0,0 +1,100 @@
+VkFormat vulkan_texture_format(TextureFormat format)
+{
+	switch(format)
+	{
+		case TEXTURE_FORMAT_BC1:
+			return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case TEXTURE_FORMAT_BC3:
+			return VK_FORMAT_BC3_SRGB_BLOCK;
+		case TEXTURE_FORMAT_BC7:
+			return VK_FORMAT_BC7_SRGB_BLOCK;
+	}
+	panic();
+}
+
+// Maps a cooked texture file. Unless decode_blocks is set, the levels point straight into the
+// mapping. Otherwise every level is decoded to RGBA8 and the mapping is released right away.
+void vulkan_load_texture(VulkanTextureData* data, char* texture_filename, bool decode_blocks)
+{
+	*data = (VulkanTextureData){};
+
+	int32_t file = open(texture_filename, O_RDONLY);
+	if(file == -1)
+	{
+		printf("Failed to open file: %s\n", texture_filename);
+		panic();
+	}
+
+	struct stat file_stat;
+	if(fstat(file, &file_stat) == -1)
+	{
+		panic();
+	}
+
+	data->mapping_size = file_stat.st_size;
+	data->mapping      = mmap(0, data->mapping_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+	if(data->mapping == MAP_FAILED)
+	{
+		panic();
+	}
+	close(file);
+
+	TextureFileHeader* header = data->mapping;
+	if(!texture_file_header_valid(header, data->mapping_size))
+	{
+		printf("Texture file %s is invalid or was cooked with an older texture cooker.\n", texture_filename);
+		panic();
+	}
+
+	data->format     = vulkan_texture_format(header->format);
+	data->extent     = (VkExtent2D){ header->width, header->height };
+	data->mip_levels = header->mip_levels;
+	for(uint32_t level = 0; level < header->mip_levels; level++)
+	{
+		data->levels[level]      = (uint8_t*)data->mapping + header->levels[level].offset;
+		data->level_sizes[level] = header->levels[level].size;
+	}
+
+	if(!decode_blocks)
+	{
+		return;
+	}
+
+	VkDeviceSize decoded_size = 0;
+	for(uint32_t level = 0; level < header->mip_levels; level++)
+	{
+		decoded_size += (VkDeviceSize)texture_level_dimension(header->width, level) * texture_level_dimension(header->height, level) * 4;
+	}
+	data->decoded = malloc(decoded_size);
+	if(data->decoded == 0)
+	{
+		panic();
+	}
+
+	uint8_t* pixels = data->decoded;
+	for(uint32_t level = 0; level < header->mip_levels; level++)
+	{
+		uint32_t level_width  = texture_level_dimension(header->width, level);
+		uint32_t level_height = texture_level_dimension(header->height, level);
+		texture_decode_level(header->format, data->levels[level], level_width, level_height, pixels);
+
+		data->levels[level]      = pixels;
+		data->level_sizes[level] = (VkDeviceSize)level_width * level_height * 4;
+		pixels += data->level_sizes[level];
+	}
+	data->format = VK_FORMAT_R8G8B8A8_SRGB;
+
+	munmap(data->mapping, data->mapping_size);
+	data->mapping      = 0;
+	data->mapping_size = 0;
+}
+
+void vulkan_free_texture_data(VulkanTextureData* data)
+{
+	if(data->mapping != 0)
+	{
+		munmap(data->mapping, data->mapping_size);
+	}
+	free(data->decoded);
+	*data = (VulkanTextureData){};
+}
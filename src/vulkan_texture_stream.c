@@ -0,0 +1,407 @@
+// Streaming texture uploads.
+//
+// 1. vulkan_stream_texture queues a cooked texture for the load thread.
+// 2. The load thread maps the file and hands back its levels, decoding them first if the device
+//    can't sample the file's block format.
+// 3. vulkan_update_texture_stream, called once per frame, copies loaded levels into the staging
+//    ring and records their copies into the frame's transfer batch.
+// 4. Once the transfer timeline passes the upload, the texture is resident, and
+//    vulkan_record_texture_acquires hands it over to the graphics queue in the next frame, which
+//    generates its mip chain if it came without one.
+//
+// 5. vulkan_bind_textures then writes it into its slot of the texture array.
+//
+// Until then the placeholder texture is sampled instead, so nothing waits on a texture.
+
+void* vulkan_texture_load_thread(void* argument)
+{
+	VulkanTextureStream* stream = argument;
+
+	while(true)
+	{
+		pthread_mutex_lock(&stream->mutex);
+		while(stream->load_queue_len == 0)
+		{
+			pthread_cond_wait(&stream->queued_condition, &stream->mutex);
+		}
+
+		VulkanTexture* texture = stream->load_queue[stream->load_queue_first];
+		stream->load_queue_first = (stream->load_queue_first + 1) % TEXTURES_COUNT;
+		stream->load_queue_len--;
+		pthread_mutex_unlock(&stream->mutex);
+
+		VulkanTextureData data;
+		vulkan_load_texture(&data, texture->path, stream->decode_blocks);
+
+		pthread_mutex_lock(&stream->mutex);
+		texture->data   = data;
+		texture->loaded = true;
+		pthread_mutex_unlock(&stream->mutex);
+	}
+
+	return 0;
+}
+
+void vulkan_initialize_texture_stream(VulkanContext* ctx, bool decode_blocks)
+{
+	VulkanTextureStream* stream = &ctx->texture_stream;
+	*stream = (VulkanTextureStream){};
+	stream->decode_blocks = decode_blocks;
+
+	if(pthread_mutex_init(&stream->mutex, 0) != 0
+		|| pthread_cond_init(&stream->queued_condition, 0) != 0
+		|| pthread_create(&stream->load_thread, 0, vulkan_texture_load_thread, stream) != 0)
+	{
+		panic();
+	}
+}
+
+void vulkan_stream_texture(VulkanContext* ctx, VulkanTexture* texture, char* path)
+{
+	VulkanTextureStream* stream = &ctx->texture_stream;
+
+	*texture = (VulkanTexture){};
+	texture->state = VULKAN_TEXTURE_STATE_LOADING;
+	texture->path  = path;
+
+	pthread_mutex_lock(&stream->mutex);
+	if(stream->load_queue_len == TEXTURES_COUNT)
+	{
+		panic();
+	}
+	stream->load_queue[(stream->load_queue_first + stream->load_queue_len) % TEXTURES_COUNT] = texture;
+	stream->load_queue_len++;
+	pthread_cond_signal(&stream->queued_condition);
+	pthread_mutex_unlock(&stream->mutex);
+}
+
+// Copies a texture's levels into the staging ring and records the texture's upload into the
+// current transfer batch. Returns false if the ring or every batch is full, in which case the
+// upload should be retried once earlier uploads have completed.
+bool vulkan_record_texture_upload(VulkanContext* ctx, VulkanTexture* texture, VulkanTextureData* data)
+{
+	VkCommandBuffer command_buffer = vulkan_begin_transfer_batch(ctx);
+	if(command_buffer == 0)
+	{
+		return false;
+	}
+
+	// Without a full chain of levels, only level 0 is uploaded. The rest are blitted down from it
+	// on the graphics queue. Blits can't write block compressed images, which is why cooked
+	// textures always come with a full chain, so only RGBA8 data may leave levels out.
+	uint32_t mip_levels      = vulkan_mip_levels_for_extent(data->extent);
+	bool     generate_mips   = data->mip_levels < mip_levels;
+	uint32_t uploaded_levels = generate_mips ? 1 : mip_levels;
+	if(generate_mips && data->format != VK_FORMAT_R8G8B8A8_SRGB)
+	{
+		panic();
+	}
+
+	// Levels go into a single ring allocation, each aligned for its copy. The staging alignment
+	// is a multiple of every block size.
+	VkDeviceSize level_offsets[TEXTURE_FILE_LEVELS_MAX];
+	VkDeviceSize staging_size = 0;
+	for(uint32_t level = 0; level < uploaded_levels; level++)
+	{
+		level_offsets[level] = staging_size;
+		staging_size = (staging_size + data->level_sizes[level] + VULKAN_STAGING_ALIGNMENT - 1) & ~(VkDeviceSize)(VULKAN_STAGING_ALIGNMENT - 1);
+	}
+
+	VkDeviceSize staging_offset;
+	uint8_t* staging_data = vulkan_staging_ring_allocate(&ctx->staging_ring, staging_size, VULKAN_STAGING_ALIGNMENT, &staging_offset);
+	if(staging_data == 0)
+	{
+		return false;
+	}
+
+	VkBufferImageCopy regions[TEXTURE_FILE_LEVELS_MAX];
+	for(uint32_t level = 0; level < uploaded_levels; level++)
+	{
+		memcpy(staging_data + level_offsets[level], data->levels[level], data->level_sizes[level]);
+
+		regions[level] = (VkBufferImageCopy)
+		{
+			.bufferOffset      = staging_offset + level_offsets[level],
+			.bufferRowLength   = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource  = (VkImageSubresourceLayers)
+			{
+				.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel       = level,
+				.baseArrayLayer = 0,
+				.layerCount     = 1
+			},
+			.imageOffset       = (VkOffset3D){0, 0, 0},
+			.imageExtent       = (VkExtent3D)
+			{
+				texture_level_dimension(data->extent.width, level),
+				texture_level_dimension(data->extent.height, level),
+				1
+			}
+		};
+	}
+
+	texture->extent        = data->extent;
+	texture->mip_levels    = mip_levels;
+	texture->generate_mips = generate_mips;
+
+	vulkan_allocate_image(
+		ctx,
+		&texture->image,
+		texture->extent,
+		texture->mip_levels,
+		data->format,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (generate_mips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0));
+
+	vulkan_create_image_view(
+		ctx,
+		&texture->image.image,
+		&texture->image.view,
+		data->format,
+		VK_IMAGE_ASPECT_COLOR_BIT);
+
+	VulkanBarrierBatch barriers;
+	vulkan_begin_barrier_batch(&barriers, command_buffer);
+
+	// Nothing has used the image yet, so the transition only has to come before the copy.
+	vulkan_batch_image_barrier(
+		&barriers,
+		texture->image.image,
+		vulkan_image_subresources(VK_IMAGE_ASPECT_COLOR_BIT),
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE,
+		VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED);
+	vulkan_flush_barrier_batch(&barriers);
+
+	vkCmdCopyBufferToImage(
+		command_buffer,
+		ctx->staging_ring.buffer.buffer,
+		texture->image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		uploaded_levels,
+		regions);
+
+	// With a separate transfer queue family, this is the release half of the ownership transfer,
+	// and the graphics queue finishes it in vulkan_record_texture_acquires. Every level stays in
+	// TRANSFER_DST_OPTIMAL until then.
+	if(vulkan_transfer_needs_ownership_transfer(ctx))
+	{
+		vulkan_batch_image_barrier(
+			&barriers,
+			texture->image.image,
+			vulkan_image_subresources(VK_IMAGE_ASPECT_COLOR_BIT),
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COPY_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			ctx->transfer_family_index,
+			ctx->graphics_family_index);
+		vulkan_flush_barrier_batch(&barriers);
+	}
+
+	texture->acquire_pending       = true;
+	texture->state                 = VULKAN_TEXTURE_STATE_UPLOADING;
+	texture->upload_timeline_value = vulkan_transfer_batch_timeline_value(ctx);
+	return true;
+}
+
+void vulkan_update_texture_stream(VulkanContext* ctx)
+{
+	VulkanTextureStream* stream = &ctx->texture_stream;
+
+	uint64_t completed_value = vulkan_transfer_completed_value(ctx);
+
+	// Collect loaded textures under the lock, and upload them outside of it so that the load
+	// thread isn't held up by the copies.
+	VulkanTexture* loaded_textures[TEXTURES_COUNT];
+	uint32_t       loaded_textures_len = 0;
+
+	pthread_mutex_lock(&stream->mutex);
+	for(uint32_t texture_index = 0; texture_index < TEXTURES_COUNT; texture_index++)
+	{
+		VulkanTexture* texture = &ctx->textures[texture_index];
+		if(texture->state == VULKAN_TEXTURE_STATE_LOADING && texture->loaded)
+		{
+			loaded_textures[loaded_textures_len++] = texture;
+		}
+	}
+	pthread_mutex_unlock(&stream->mutex);
+
+	for(uint32_t texture_index = 0; texture_index < TEXTURES_COUNT; texture_index++)
+	{
+		VulkanTexture* texture = &ctx->textures[texture_index];
+		if(texture->state == VULKAN_TEXTURE_STATE_UPLOADING && texture->upload_timeline_value <= completed_value)
+		{
+			texture->state = VULKAN_TEXTURE_STATE_RESIDENT;
+		}
+	}
+
+	for(uint32_t loaded_index = 0; loaded_index < loaded_textures_len; loaded_index++)
+	{
+		VulkanTexture* texture = loaded_textures[loaded_index];
+		if(!vulkan_record_texture_upload(ctx, texture, &texture->data))
+		{
+			break;
+		}
+
+		vulkan_free_texture_data(&texture->data);
+	}
+}
+
+// Takes over every texture which became resident since the last call: adds the acquire half of the
+// ownership transfer to barriers if there was one, and generates the texture's mip chain
+// if it needs one, which flushes barriers first. Returns the highest transfer timeline value the
+// textures depend on, which the submission must wait on, or 0 if nothing was acquired.
+uint64_t vulkan_record_texture_acquires(VulkanContext* ctx, VulkanBarrierBatch* barriers)
+{
+	bool     ownership_transfer = vulkan_transfer_needs_ownership_transfer(ctx);
+	uint64_t wait_value         = 0;
+
+	VulkanTexture* mip_textures[TEXTURES_COUNT];
+	uint32_t       mip_textures_len = 0;
+
+	for(uint32_t texture_index = 0; texture_index < TEXTURES_COUNT; texture_index++)
+	{
+		VulkanTexture* texture = &ctx->textures[texture_index];
+		if(texture->state != VULKAN_TEXTURE_STATE_RESIDENT || !texture->acquire_pending)
+		{
+			continue;
+		}
+
+		// Without an ownership transfer, this only makes the upload visible. An acquire's source
+		// stages are ignored, as the release already made the upload available.
+		uint32_t              src_queue_family = ownership_transfer ? ctx->transfer_family_index : VK_QUEUE_FAMILY_IGNORED;
+		uint32_t              dst_queue_family = ownership_transfer ? ctx->graphics_family_index : VK_QUEUE_FAMILY_IGNORED;
+		VkPipelineStageFlags2 src_stages       = ownership_transfer ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_COPY_BIT;
+		VkAccessFlags2        src_access       = ownership_transfer ? VK_ACCESS_2_NONE : VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+		if(texture->generate_mips)
+		{
+			vulkan_batch_image_barrier(
+				barriers,
+				texture->image.image,
+				vulkan_image_subresources(VK_IMAGE_ASPECT_COLOR_BIT),
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				src_stages,
+				src_access,
+				VK_PIPELINE_STAGE_2_BLIT_BIT,
+				VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				src_queue_family,
+				dst_queue_family);
+			mip_textures[mip_textures_len++] = texture;
+		}
+		else
+		{
+			vulkan_batch_image_barrier(
+				barriers,
+				texture->image.image,
+				vulkan_image_subresources(VK_IMAGE_ASPECT_COLOR_BIT),
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				src_stages,
+				src_access,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				src_queue_family,
+				dst_queue_family);
+		}
+
+		texture->acquire_pending = false;
+		if(texture->upload_timeline_value > wait_value)
+		{
+			wait_value = texture->upload_timeline_value;
+		}
+	}
+
+	if(mip_textures_len > 0)
+	{
+		vulkan_flush_barrier_batch(barriers);
+	}
+	for(uint32_t mip_texture_index = 0; mip_texture_index < mip_textures_len; mip_texture_index++)
+	{
+		VulkanTexture* texture = mip_textures[mip_texture_index];
+		vulkan_generate_mipmaps(
+			barriers->command_buffer,
+			texture->image.image,
+			texture->extent,
+			texture->mip_levels,
+			ctx->texture_mip_filter);
+	}
+
+	return wait_value;
+}
+
+// Writes every texture which has been acquired since the last call into its slot of a texture
+// array binding, in every frame's descriptor set of every pipeline which samples textures, as
+// those all have to agree on which slots materials may use. The binding must be PARTIALLY_BOUND and
+// UPDATE_UNUSED_WHILE_PENDING: other frames may still be rendering with their set, which is fine as
+// long as they don't sample the slot, and they can't have, as it wasn't bound until now.
+void vulkan_bind_textures(VulkanContext* ctx, VulkanPipeline** pipelines, uint32_t pipelines_len, uint32_t binding)
+{
+	VkWriteDescriptorSet  write_descriptor_sets[TEXTURES_COUNT * FRAMES_IN_FLIGHT_COUNT * pipelines_len];
+	VkDescriptorImageInfo descriptor_image_infos[TEXTURES_COUNT];
+	uint32_t              write_descriptor_sets_len = 0;
+
+	for(uint32_t texture_index = 0; texture_index < TEXTURES_COUNT; texture_index++)
+	{
+		VulkanTexture* texture = &ctx->textures[texture_index];
+		if(texture->state != VULKAN_TEXTURE_STATE_RESIDENT || texture->acquire_pending || texture->bound)
+		{
+			continue;
+		}
+
+		descriptor_image_infos[texture_index] = (VkDescriptorImageInfo)
+		{
+			.sampler     = ctx->texture_sampler,
+			.imageView   = texture->image.view,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+
+		for(uint32_t pipeline_index = 0; pipeline_index < pipelines_len; pipeline_index++)
+		{
+			for(uint8_t frame_index = 0; frame_index < FRAMES_IN_FLIGHT_COUNT; frame_index++)
+			{
+				write_descriptor_sets[write_descriptor_sets_len++] = (VkWriteDescriptorSet)
+				{
+					.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.pNext            = 0,
+					.dstSet           = pipelines[pipeline_index]->descriptor_sets[frame_index],
+					.dstBinding       = binding,
+					.dstArrayElement  = texture_index,
+					.descriptorCount  = 1,
+					.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					.pImageInfo       = &descriptor_image_infos[texture_index],
+					.pBufferInfo      = 0,
+					.pTexelBufferView = 0
+				};
+			}
+		}
+
+		texture->bound = true;
+	}
+
+	if(write_descriptor_sets_len > 0)
+	{
+		vkUpdateDescriptorSets(ctx->device, write_descriptor_sets_len, write_descriptor_sets, 0, 0);
+	}
+}
+
+// The texture array slot to sample in place of texture_index, which is the placeholder's until the
+// texture is bound.
+uint32_t vulkan_resident_texture_index(VulkanContext* ctx, uint32_t texture_index)
+{
+	if(!ctx->textures[texture_index].bound)
+	{
+		return VULKAN_PLACEHOLDER_TEXTURE;
+	}
+	return texture_index;
+}
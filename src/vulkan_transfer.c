@@ -0,0 +1,301 @@
+// Uploads are recorded into transfer batches, which are submitted to the transfer queue and signal
+// the transfer timeline semaphore on completion. Nothing here blocks on the GPU: a batch is only
+// recorded again, and its staging ring regions only reused, once the timeline shows it is done.
+
+void vulkan_initialize_transfer(VulkanContext* ctx)
+{
+	VkSemaphoreCreateInfo timeline_create_info =
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &(VkSemaphoreTypeCreateInfo)
+		{
+			.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.pNext         = 0,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue  = 0
+		},
+		.flags = 0
+	};
+	vk_verify(vkCreateSemaphore(ctx->device, &timeline_create_info, 0, &ctx->transfer_timeline));
+	ctx->transfer_timeline_value = 0;
+
+	VkCommandPoolCreateInfo command_pool_create_info =
+	{
+		.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext            = 0,
+		.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = ctx->transfer_family_index
+	};
+	vk_verify(vkCreateCommandPool(ctx->device, &command_pool_create_info, 0, &ctx->transfer_command_pool));
+
+	for(uint8_t batch_index = 0; batch_index < VULKAN_TRANSFER_BATCHES_COUNT; batch_index++)
+	{
+		VkCommandBufferAllocateInfo allocate_info =
+		{
+			.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext              = 0,
+			.commandPool        = ctx->transfer_command_pool,
+			.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		vk_verify(vkAllocateCommandBuffers(ctx->device, &allocate_info, &ctx->transfer_batches[batch_index].command_buffer));
+		ctx->transfer_batches[batch_index].timeline_value = 0;
+	}
+	ctx->transfer_batch      = 0;
+	ctx->buffer_acquires_len = 0;
+
+	vulkan_create_staging_ring(ctx, &ctx->staging_ring, VULKAN_STAGING_RING_SIZE);
+}
+
+uint64_t vulkan_transfer_completed_value(VulkanContext* ctx)
+{
+	uint64_t value;
+	vk_verify(vkGetSemaphoreCounterValue(ctx->device, ctx->transfer_timeline, &value));
+	return value;
+}
+
+// Whether resources written by the transfer queue have to be released by it and acquired by the
+// graphics queue before use.
+bool vulkan_transfer_needs_ownership_transfer(VulkanContext* ctx)
+{
+	return ctx->transfer_family_index != ctx->graphics_family_index;
+}
+
+// Starts recording a batch, unless one is already being recorded. Returns null if every batch is
+// still in flight, in which case uploads should be retried later.
+VkCommandBuffer vulkan_begin_transfer_batch(VulkanContext* ctx)
+{
+	if(ctx->transfer_batch != 0)
+	{
+		return ctx->transfer_batch->command_buffer;
+	}
+
+	uint64_t completed_value = vulkan_transfer_completed_value(ctx);
+	vulkan_staging_ring_reclaim(&ctx->staging_ring, completed_value);
+
+	for(uint8_t batch_index = 0; batch_index < VULKAN_TRANSFER_BATCHES_COUNT; batch_index++)
+	{
+		VulkanTransferBatch* batch = &ctx->transfer_batches[batch_index];
+		if(batch->timeline_value > completed_value)
+		{
+			continue;
+		}
+
+		vk_verify(vkResetCommandBuffer(batch->command_buffer, 0));
+
+		VkCommandBufferBeginInfo begin_info =
+		{
+			.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.pNext            = 0,
+			.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			.pInheritanceInfo = 0
+		};
+		vk_verify(vkBeginCommandBuffer(batch->command_buffer, &begin_info));
+
+		ctx->transfer_batch = batch;
+		return batch->command_buffer;
+	}
+
+	return 0;
+}
+
+// The timeline value which the batch being recorded will signal once submitted.
+uint64_t vulkan_transfer_batch_timeline_value(VulkanContext* ctx)
+{
+	return ctx->transfer_timeline_value + 1;
+}
+
+// Copies size bytes of data to dst_buffer at dst_offset through the staging ring, recorded into the
+// current transfer batch. Returns false if the ring or every batch is full, in which case the upload
+// should be retried once earlier uploads have completed.
+//
+// The destination must be handed over with vulkan_release_buffer before the graphics queue uses it.
+bool vulkan_upload_buffer(VulkanContext* ctx, VkBuffer dst_buffer, VkDeviceSize dst_offset, void* data, VkDeviceSize size)
+{
+	VkCommandBuffer command_buffer = vulkan_begin_transfer_batch(ctx);
+	if(command_buffer == 0)
+	{
+		return false;
+	}
+
+	VkDeviceSize staging_offset;
+	void* staging_data = vulkan_staging_ring_allocate(&ctx->staging_ring, size, VULKAN_STAGING_ALIGNMENT, &staging_offset);
+	if(staging_data == 0)
+	{
+		return false;
+	}
+	memcpy(staging_data, data, size);
+
+	VkBufferCopy buffer_copy =
+	{
+		.srcOffset = staging_offset,
+		.dstOffset = dst_offset,
+		.size      = size
+	};
+	vkCmdCopyBuffer(command_buffer, ctx->staging_ring.buffer.buffer, dst_buffer, 1, &buffer_copy);
+
+	return true;
+}
+
+// Makes uploads to a buffer range in the current batch visible to the graphics queue, for the given
+// stages and accesses. With a separate transfer queue family this releases the range, and the next
+// frame acquires it in vulkan_record_buffer_acquires.
+void vulkan_release_buffer(
+	VulkanContext*        ctx,
+	VkBuffer              buffer,
+	VkDeviceSize          offset,
+	VkDeviceSize          size,
+	VkPipelineStageFlags2 dst_stages,
+	VkAccessFlags2        dst_access)
+{
+	VkCommandBuffer command_buffer = vulkan_begin_transfer_batch(ctx);
+	if(command_buffer == 0)
+	{
+		panic();
+	}
+
+	VulkanBarrierBatch barriers;
+	vulkan_begin_barrier_batch(&barriers, command_buffer);
+
+	if(!vulkan_transfer_needs_ownership_transfer(ctx))
+	{
+		vulkan_batch_buffer_barrier(
+			&barriers,
+			buffer,
+			offset,
+			size,
+			VK_PIPELINE_STAGE_2_COPY_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			dst_stages,
+			dst_access,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED);
+		vulkan_flush_barrier_batch(&barriers);
+		return;
+	}
+
+	if(ctx->buffer_acquires_len == VULKAN_BUFFER_ACQUIRES_MAX)
+	{
+		panic();
+	}
+
+	vulkan_batch_buffer_barrier(
+		&barriers,
+		buffer,
+		offset,
+		size,
+		VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE,
+		ctx->transfer_family_index,
+		ctx->graphics_family_index);
+	vulkan_flush_barrier_batch(&barriers);
+
+	ctx->buffer_acquires[ctx->buffer_acquires_len++] = (VulkanBufferAcquire)
+	{
+		.buffer         = buffer,
+		.offset         = offset,
+		.size           = size,
+		.dst_stages     = dst_stages,
+		.dst_access     = dst_access,
+		.timeline_value = vulkan_transfer_batch_timeline_value(ctx)
+	};
+}
+
+// Adds the acquire half of every released buffer range whose transfer batch has been submitted to
+// barriers. Unlike textures, buffers are acquired without waiting for the upload to complete,
+// as whatever uses them can't go ahead without them. Returns the highest transfer timeline value
+// the submission must wait on, or 0 if nothing was acquired.
+uint64_t vulkan_record_buffer_acquires(VulkanContext* ctx, VulkanBarrierBatch* barriers)
+{
+	uint64_t wait_value          = 0;
+	uint32_t buffer_acquires_len = 0;
+
+	for(uint32_t acquire_index = 0; acquire_index < ctx->buffer_acquires_len; acquire_index++)
+	{
+		VulkanBufferAcquire* acquire = &ctx->buffer_acquires[acquire_index];
+		if(acquire->timeline_value > ctx->transfer_timeline_value)
+		{
+			ctx->buffer_acquires[buffer_acquires_len++] = *acquire;
+			continue;
+		}
+
+		vulkan_batch_buffer_barrier(
+			barriers,
+			acquire->buffer,
+			acquire->offset,
+			acquire->size,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			acquire->dst_stages,
+			acquire->dst_access,
+			ctx->transfer_family_index,
+			ctx->graphics_family_index);
+
+		if(acquire->timeline_value > wait_value)
+		{
+			wait_value = acquire->timeline_value;
+		}
+	}
+	ctx->buffer_acquires_len = buffer_acquires_len;
+
+	return wait_value;
+}
+
+// Submits the batch being recorded, if any, and returns the timeline value it signals.
+uint64_t vulkan_submit_transfer_batch(VulkanContext* ctx)
+{
+	VulkanTransferBatch* batch = ctx->transfer_batch;
+	if(batch == 0)
+	{
+		return ctx->transfer_timeline_value;
+	}
+
+	vk_verify(vkEndCommandBuffer(batch->command_buffer));
+
+	batch->timeline_value = vulkan_transfer_batch_timeline_value(ctx);
+
+	VkSubmitInfo submit_info =
+	{
+		.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext                = &(VkTimelineSemaphoreSubmitInfo)
+		{
+			.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+			.pNext                     = 0,
+			.waitSemaphoreValueCount   = 0,
+			.pWaitSemaphoreValues      = 0,
+			.signalSemaphoreValueCount = 1,
+			.pSignalSemaphoreValues    = &batch->timeline_value
+		},
+		.waitSemaphoreCount   = 0,
+		.pWaitSemaphores      = 0,
+		.pWaitDstStageMask    = 0,
+		.commandBufferCount   = 1,
+		.pCommandBuffers      = &batch->command_buffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores    = &ctx->transfer_timeline
+	};
+	vk_verify(vkQueueSubmit(ctx->transfer_queue, 1, &submit_info, 0));
+
+	vulkan_staging_ring_retire(&ctx->staging_ring, batch->timeline_value);
+
+	ctx->transfer_timeline_value = batch->timeline_value;
+	ctx->transfer_batch          = 0;
+	return batch->timeline_value;
+}
+
+// Blocks until the transfer timeline reaches timeline_value. Only meant for initialization.
+void vulkan_wait_for_transfer(VulkanContext* ctx, uint64_t timeline_value)
+{
+	VkSemaphoreWaitInfo wait_info =
+	{
+		.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.pNext          = 0,
+		.flags          = 0,
+		.semaphoreCount = 1,
+		.pSemaphores    = &ctx->transfer_timeline,
+		.pValues        = &timeline_value
+	};
+	vk_verify(vkWaitSemaphores(ctx->device, &wait_info, UINT64_MAX));
+}
@@ -7,6 +7,7 @@
 #include "panic.c"
 #include "linalg.c"
 #include "random.c"
+#include "hash.c"
 
 #define STATIC_MESHES_LEN 2
 
@@ -23,6 +24,8 @@
 #define XCB_A 0x0061
 #define XCB_S 0x0073
 #define XCB_D 0x0064
+#define XCB_P 0x0070
+#define XCB_M 0x006d
 
 #include <xcb/xcb.h>
 #include <xcb/xfixes.h>
@@ -40,6 +43,7 @@
 typedef struct
 {
 	bool                running;
+	bool                renderer_idle;
 	float               time_since_start;
 	struct timespec     time_prev;
 	
@@ -153,7 +157,8 @@ int32_t main(int32_t argc, char** argv)
 
 	renderer_initialize(&xcb.renderer, &xcb_renderer_platform_data);
 
-	xcb.running = true;
+	xcb.running       = true;
+	xcb.renderer_idle = false;
 
 	xcb.input.mouse_x = 0;
 	xcb.input.mouse_y = 0;
@@ -187,8 +192,28 @@ int32_t main(int32_t argc, char** argv)
     	xcb.input.mouse_delta_x = 0;
     	xcb.input.mouse_delta_y = 0;
     	
-		xcb_generic_event_t* e;
-		while((e = xcb_poll_for_event(xcb.connection)))
+		// While the renderer has nothing to render to, as when the window is minimized, block until
+		// the window changes rather than spin through frames. The time spent waiting isn't passed on
+		// to the game as one long frame.
+		xcb_generic_event_t* e = 0;
+		if(xcb.renderer_idle)
+		{
+			e = xcb_wait_for_event(xcb.connection);
+			if(e == 0)
+			{
+				panic();
+			}
+			if(clock_gettime(CLOCK_REALTIME, &xcb.time_prev))
+			{
+				panic();
+			}
+		}
+		else
+		{
+			e = xcb_poll_for_event(xcb.connection);
+		}
+
+		for(; e; e = xcb_poll_for_event(xcb.connection))
 		{
 			switch(e->response_type & ~0x80)
 			{
@@ -280,6 +305,16 @@ int32_t main(int32_t argc, char** argv)
                     		input_button_press(&xcb.input.move_right);
         					break;
                 		}
+                		case XCB_P:
+                		{
+                    		input_button_press(&xcb.input.toggle_depth_prepass);
+        					break;
+                		}
+                		case XCB_M:
+                		{
+                    		input_button_press(&xcb.input.cycle_msaa_tier);
+        					break;
+                		}
                 		default:
                     	{
                         	break;
@@ -313,6 +348,16 @@ int32_t main(int32_t argc, char** argv)
                     		input_button_release(&xcb.input.move_right);
         					break;
                 		}
+                		case XCB_P:
+                		{
+                    		input_button_release(&xcb.input.toggle_depth_prepass);
+        					break;
+                		}
+                		case XCB_M:
+                		{
+                    		input_button_release(&xcb.input.cycle_msaa_tier);
+        					break;
+                		}
                 		default:
                     	{
                         	break;
@@ -350,7 +395,7 @@ int32_t main(int32_t argc, char** argv)
 		// of both GL and Vulkan sufficiently to develop a robust renderer front-end. The ideal of the
 		// split is to conserve all possible performance characteristics of each API while minimizing the
 		// redundancy in the two implementations.
-		renderer_loop(&xcb.renderer, &xcb.render_list);
+		xcb.renderer_idle = !renderer_loop(&xcb.renderer, &xcb.render_list);
 	}
 
 	return 0;